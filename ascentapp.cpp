@@ -73,10 +73,17 @@ bool AscentApp::OnInit() {
 
 void AscentApp::OnLoop() {
 
+	if (plan.empty() && currentlyDisplaying == windowType::Map && engine->travelling()) {
+		Direction step = engine->travelStep();
+		if (step != Direction::NONE)
+			plan.push({ActionType::Move, step, '\0'});
+	}
+
 	if (!plan.empty() && currentlyDisplaying == windowType::Map) {
 		if (!engine->Act(plan.front())) {
 			while (!plan.empty())
 				plan.pop();
+			engine->cancelTravel();
 		} else
 			plan.pop();
 	}
@@ -122,6 +129,7 @@ void AscentApp::OnEvent(SDL_Event* event) {
 		case SDL_KEYDOWN:
 			switch (userInputRequested) {
 				case InputType::Standard:
+					engine->cancelTravel();
 					onKeyDown_Standard(&event->key);
 					break;
 				case InputType::InventoryItemToDrop:
@@ -141,13 +149,16 @@ void AscentApp::OnEvent(SDL_Event* event) {
 					mouseSquareX - numSquaresX / 2,
 					mouseSquareY - numSquaresY / 2
 				};
-				std::queue<Direction> * moves = engine->playerAstar(Point(0,0), dest);
-				while (!moves->empty()) {
-//					printf("%d\n", (int)moves->front());
-					plan.push({ActionType::Move, moves->front(), '\0'});
-					moves->pop();
+				engine->cancelTravel();
+				PathBuffer moves;
+				// Out of sight or out of reach from here; route through the regions behind the doors instead
+				if (!engine->playerAstar(Point(0,0), dest, moves))
+					engine->beginTravel(dest);
+				while (!moves.empty()) {
+//					printf("%d\n", (int)moves.back());
+					plan.push({ActionType::Move, moves.back(), '\0'});
+					moves.pop_back();
 				}
-				delete moves;
 //				printf("\n");
 			}
 		default:
@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "engine.h"
+#include "threadpool.h"
+
+/// @brief Number of moves the random policy tries before waiting instead
+#define POLICY_MOVE_ATTEMPTS 8
+
+/// @brief Outcome of one game
+struct GameResult {
+	/// @brief Whether the player was still alive at the end
+	bool survived;
+	/// @brief Gold gained over the starting amount
+	long gold;
+	/// @brief The engine's counters and timings
+	EngineStats stats;
+};
+
+/// @brief Play one game with a random policy: pick up anything underfoot, otherwise move in a random direction
+///
+/// @param seed Seed for the engine and the policy
+/// @param maxTurns The most turns to play
+/// @param budget Memory resident regions may take up, in bytes
+///
+/// @return The outcome
+GameResult playGame(std::mt19937::result_type seed, unsigned long maxTurns, std::size_t budget) {
+	Engine engine(1, seed);
+	engine.setResidentBudget(budget);
+	std::mt19937 policy(seed);
+	std::uniform_int_distribution<int> dirdist(0, 7);
+	long startGold = engine.getPlayerInventory().total(ItemType::Gold);
+	while (engine.playerAlive() && engine.getStats().turns < maxTurns) {
+		if (engine.underWitch() != Foreground::NONE && engine.Act({ActionType::Pickup, Direction::NONE, '\0'}))
+			continue;
+		bool moved = false;
+		for (int i = 0; i < POLICY_MOVE_ATTEMPTS && !moved; i++)
+			moved = engine.Act({ActionType::Move, (Direction)dirdist(policy), '\0'});
+		if (!moved)
+			engine.Act({ActionType::NONE, Direction::NONE, '\0'});
+	}
+	return {
+		engine.playerAlive(),
+		(long)engine.getPlayerInventory().total(ItemType::Gold) - startGold,
+		engine.getStats()
+	};
+}
+
+/// @brief Play many seeded games at once and report on them
+int main(int argc, char* argv[]) {
+	unsigned long games = 100;
+	unsigned long maxTurns = 1000;
+	unsigned int threads = 0;
+	std::mt19937::result_type seed = 1;
+	std::size_t budget = REGION_RESIDENT_BUDGET;
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && strcmp(argv[i], "-n") == 0)
+			games = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && strcmp(argv[i], "-t") == 0)
+			maxTurns = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && strcmp(argv[i], "-j") == 0)
+			threads = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && strcmp(argv[i], "-s") == 0)
+			seed = (std::mt19937::result_type)strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && strcmp(argv[i], "-m") == 0)
+			budget = (std::size_t)strtoul(argv[++i], NULL, 10);
+		else {
+			fprintf(stderr, "Usage: %s [-n games] [-t max turns] [-j threads] [-s first seed] [-m region memory budget in bytes]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (threads == 0)
+		threads = MAX(1u, std::thread::hardware_concurrency());
+
+	std::vector<GameResult> results(games);
+	ThreadPool pool(threads);
+	auto started = std::chrono::steady_clock::now();
+	pool.run(games, [&results, seed, maxTurns, budget](std::size_t i, unsigned int) {
+		results[i] = playGame(seed + (std::mt19937::result_type)i, maxTurns, budget);
+	});
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	EngineStats total;
+	unsigned long survived = 0;
+	unsigned long shortest = (unsigned long)-1;
+	unsigned long longest = 0;
+	long gold = 0;
+	for (const GameResult & result : results) {
+		total.turns += result.stats.turns;
+		total.regionsGenerated += result.stats.regionsGenerated;
+		total.regionsDiscarded += result.stats.regionsDiscarded;
+		total.regionsRestored += result.stats.regionsRestored;
+		total.regionsPagedOut += result.stats.regionsPagedOut;
+		total.regionsPagedIn += result.stats.regionsPagedIn;
+		total.monsterTurns += result.stats.monsterTurns;
+		total.playerSeconds += result.stats.playerSeconds;
+		total.activitySeconds += result.stats.activitySeconds;
+		total.decideSeconds += result.stats.decideSeconds;
+		total.commitSeconds += result.stats.commitSeconds;
+		total.fovSeconds += result.stats.fovSeconds;
+		shortest = MIN(shortest, result.stats.turns);
+		longest = MAX(longest, result.stats.turns);
+		gold += result.gold;
+		if (result.survived)
+			survived++;
+	}
+	double n = (games > 0) ? (double)games : 1.0;
+	double phases = total.playerSeconds + total.activitySeconds + total.decideSeconds + total.commitSeconds + total.fovSeconds;
+	if (phases <= 0)
+		phases = 1;
+
+	printf("Games: %lu on %u threads, up to %lu turns each, seeds %lu to %lu\n", games, threads, maxTurns,
+			(unsigned long)seed, (unsigned long)seed + (games > 0 ? games - 1 : 0));
+	printf("Wall time: %.3f s\n", wall);
+	printf("Turns: %lu (%.0f turns/s)\n", total.turns, (wall > 0) ? total.turns / wall : 0.0);
+	printf("Monster turns: %lu\n", total.monsterTurns);
+	printf("Phase time (summed over games):\n");
+	printf("\tPlayer action:  %8.3f s (%5.1f%%)\n", total.playerSeconds, 100 * total.playerSeconds / phases);
+	printf("\tActivity tiers: %8.3f s (%5.1f%%)\n", total.activitySeconds, 100 * total.activitySeconds / phases);
+	printf("\tMonster decide: %8.3f s (%5.1f%%)\n", total.decideSeconds, 100 * total.decideSeconds / phases);
+	printf("\tMonster commit: %8.3f s (%5.1f%%)\n", total.commitSeconds, 100 * total.commitSeconds / phases);
+	printf("\tPlayer FOV:     %8.3f s (%5.1f%%)\n", total.fovSeconds, 100 * total.fovSeconds / phases);
+	printf("Survived: %lu of %lu\n", survived, games);
+	printf("Turns survived: mean %.1f, min %lu, max %lu\n", total.turns / n, games > 0 ? shortest : 0, longest);
+	printf("Regions generated: mean %.1f\n", total.regionsGenerated / n);
+	printf("Regions discarded: mean %.1f, restored: mean %.1f\n", total.regionsDiscarded / n, total.regionsRestored / n);
+	printf("Regions paged out: mean %.1f, paged in: mean %.1f\n", total.regionsPagedOut / n, total.regionsPagedIn / n);
+	printf("Gold collected: mean %.1f\n", gold / n);
+	return 0;
+}
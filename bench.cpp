@@ -0,0 +1,676 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "engine.h"
+#include "search.h"
+
+/// @brief Default number of times each benchmark goes over its layouts
+#define BENCH_REPEATS 5
+
+/// @brief Seeds each layout is generated with
+#define BENCH_SEEDS 2
+
+/// @brief Searches are made from tiles this far apart along each axis of a layout
+#define SEARCH_ORIGIN_SPACING 3
+
+/// @brief Searches are made to every this-many-th open cell in view
+#define SEARCH_TARGET_SPACING 5
+
+/// @brief One in this many open cells in a view is taken by a monster, for the cost policies to route around
+#define SEARCH_MONSTER_SPACING 9
+
+/// @brief Slack allowed when comparing path costs summed in different orders
+#define COST_EPSILON 1e-6
+
+/// @brief Searches made across each synthetic grid, besides corner to corner
+#define GRID_SEARCHES 8
+
+/// @brief Seconds since a time point
+///
+/// @param since The time point
+///
+/// @return The seconds
+double secondsSince(std::chrono::steady_clock::time_point since) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+/// @brief Whether two cells of a field of view hold the same thing
+///
+/// @param a One cell
+/// @param b The other
+///
+/// @return True if equal in every field
+bool sameCell(const Visibility & a, const Visibility & b) {
+	return a.visible == b.visible && a.background == b.background && a.foreground == b.foreground
+		&& a.creature == b.creature && a.team == b.team && a.item == b.item && a.creatureHP == b.creatureHP;
+}
+
+/// @brief Reaches into Engine for the benchmarks
+class EngineBench {
+	public:
+		/// @brief The shadowcasting kernel for one octant, as FOV runs it
+		///
+		/// @tparam SwapAxes Whether lines run along the x axis rather than the y axis
+		/// @tparam XTransform Sign of x in this octant
+		/// @tparam YTransform Sign of y in this octant
+		/// @param engine The engine
+		/// @param point The point the FOV is taken from
+		/// @param region The region
+		/// @param visMap The grid to fill, relative to point
+		template <bool SwapAxes, int XTransform, int YTransform>
+		static void octant(Engine & engine, const Point& point, Region * region, VisibilityGrid & visMap) {
+			engine.FOVOctant<SwapAxes, XTransform, YTransform>(point, region, visMap);
+		}
+
+		/// @brief Take a field of view, as the engine does for searches
+		///
+		/// @param engine The engine
+		/// @param point The point the FOV is taken from
+		/// @param region The region
+		/// @param visMap The grid to fill, relative to point
+		static void view(Engine & engine, const Point& point, Region * region, VisibilityGrid & visMap) {
+			engine.FOV(point, region, visMap);
+		}
+
+		/// @brief The kernel FOVOctant replaced, for octants whose lines run along the y axis (fovlambda)
+		///
+		/// @param engine The engine
+		/// @param xTransform Sign of x in this octant
+		/// @param yTransform Sign of y in this octant
+		/// @param point The point the FOV is taken from
+		/// @param region The region
+		/// @param visMap The grid to fill, relative to point
+		static void lambdaOctant(Engine & engine, int xTransform, int yTransform, const Point& point, Region * region, VisibilityGrid & visMap) {
+			using AnglePair = std::pair<double, double>;
+			std::vector<AnglePair> * currentBlocked = new std::vector<AnglePair>;
+			std::vector<AnglePair> * nextLineBlocked = new std::vector<AnglePair>;
+
+			for (int y = 1; y < FOV_RADIUS; y++) {
+				for (auto ap : *nextLineBlocked)
+					currentBlocked->push_back(ap);
+				delete nextLineBlocked;
+				nextLineBlocked = new std::vector<AnglePair>;
+
+				double arange = 1.0 / (double)(y + 1);
+				for (int x = 0; x <= y; x++) {
+					Point tp(x * xTransform, y * yTransform);
+					lambdaCell(engine, tp, x * arange, arange, point, region, *currentBlocked, *nextLineBlocked, visMap);
+				}
+			}
+
+			delete nextLineBlocked;
+			delete currentBlocked;
+		}
+
+		/// @brief The kernel FOVOctant replaced, for octants whose lines run along the x axis (fovlambda2)
+		///
+		/// @param engine The engine
+		/// @param xTransform Sign of x in this octant
+		/// @param yTransform Sign of y in this octant
+		/// @param point The point the FOV is taken from
+		/// @param region The region
+		/// @param visMap The grid to fill, relative to point
+		static void lambdaOctant2(Engine & engine, int xTransform, int yTransform, const Point& point, Region * region, VisibilityGrid & visMap) {
+			using AnglePair = std::pair<double, double>;
+			std::vector<AnglePair> * currentBlocked = new std::vector<AnglePair>;
+			std::vector<AnglePair> * nextLineBlocked = new std::vector<AnglePair>;
+
+			for (int x = 1; x < FOV_RADIUS; x++) {
+				for (auto ap : *nextLineBlocked)
+					currentBlocked->push_back(ap);
+				delete nextLineBlocked;
+				nextLineBlocked = new std::vector<AnglePair>;
+
+				double arange = 1.0 / (double)(x + 1);
+				for (int y = 0; y <= x; y++) {
+					Point tp(x * xTransform, y * yTransform);
+					lambdaCell(engine, tp, y * arange, arange, point, region, *currentBlocked, *nextLineBlocked, visMap);
+				}
+			}
+
+			delete nextLineBlocked;
+			delete currentBlocked;
+		}
+
+	private:
+		/// @brief One cell of the replaced kernel, scanning every blocked interval in turn
+		///
+		/// @param engine The engine
+		/// @param tp The cell, relative to point
+		/// @param startingAngle The angle the cell starts at
+		/// @param arange The angle the cell spans
+		/// @param point The point the FOV is taken from
+		/// @param region The region
+		/// @param currentBlocked Intervals blocked by earlier lines
+		/// @param nextLineBlocked Intervals this line blocks
+		/// @param visMap The grid to fill, relative to point
+		static void lambdaCell(Engine & engine, const Point& tp, double startingAngle, double arange, const Point& point, Region * region,
+				const std::vector<std::pair<double, double> > & currentBlocked, std::vector<std::pair<double, double> > & nextLineBlocked,
+				VisibilityGrid & visMap) {
+			double endingAngle = startingAngle + arange;
+			double centreAngle = startingAngle + arange / 2;
+			BaF thisCell = engine.relBaF(tp, point, region);
+			bool tct = bkgrProps.at(thisCell.background).transparent;
+			bool centreAngleBlocked = false;
+			bool endingAngleBlocked = false;
+			bool startingAngleBlocked = false;
+			bool tcs = true;
+			for (auto ap : currentBlocked) {
+				if (startingAngle >= ap.first && startingAngle <= ap.second)
+					startingAngleBlocked = true;
+				if (endingAngle >= ap.first && endingAngle <= ap.second)
+					endingAngleBlocked = true;
+				if (centreAngle >= ap.first && centreAngle <= ap.second)
+					centreAngleBlocked = true;
+				if (tct) {
+					if (centreAngleBlocked || (startingAngleBlocked && endingAngleBlocked)) {
+						tcs = false;
+						break;
+					}
+				} else {
+					if (centreAngleBlocked && startingAngleBlocked && endingAngleBlocked) {
+						tcs = false;
+						break;
+					}
+				}
+			}
+
+			if (tcs) {
+				Visibility thisvs = {
+					true,
+					thisCell.background,
+					thisCell.foreground,
+					thisCell.creatureHere,
+					thisCell.creatureTeam,
+					thisCell.itemHere,
+					thisCell.HPPerHere
+				};
+				visMap.set(tp, thisvs);
+				if (!tct)
+					nextLineBlocked.push_back(std::pair<double, double>(startingAngle, endingAngle));
+			}
+		}
+};
+
+/// @brief One octant of the field of view, with both kernels for it
+struct OctantBench {
+	/// @brief Compass name of the octant
+	const char * name;
+	/// @brief Whether lines run along the x axis
+	bool swapAxes;
+	/// @brief Sign of x
+	int xTransform;
+	/// @brief Sign of y
+	int yTransform;
+	/// @brief The templated kernel
+	void (*kernel)(Engine &, const Point&, Region *, VisibilityGrid &);
+};
+
+/// @brief The octants, in the order FOV runs them
+const OctantBench octants[] = {
+	{"SSW", false, -1, 1, &EngineBench::octant<false, -1, 1>},
+	{"SSE", false, 1, 1, &EngineBench::octant<false, 1, 1>},
+	{"NNE", false, 1, -1, &EngineBench::octant<false, 1, -1>},
+	{"NNW", false, -1, -1, &EngineBench::octant<false, -1, -1>},
+	{"ESE", true, 1, 1, &EngineBench::octant<true, 1, 1>},
+	{"ENE", true, 1, -1, &EngineBench::octant<true, 1, -1>},
+	{"WSW", true, -1, 1, &EngineBench::octant<true, -1, 1>},
+	{"WNW", true, -1, -1, &EngineBench::octant<true, -1, -1>}
+};
+
+/// @brief Run the replaced kernel for an octant
+///
+/// @param engine The engine
+/// @param octant The octant
+/// @param point The point the FOV is taken from
+/// @param region The region
+/// @param visMap The grid to fill, relative to point
+inline void runLambda(Engine & engine, const OctantBench & octant, const Point& point, Region * region, VisibilityGrid & visMap) {
+	if (octant.swapAxes)
+		EngineBench::lambdaOctant2(engine, octant.xTransform, octant.yTransform, point, region, visMap);
+	else
+		EngineBench::lambdaOctant(engine, octant.xTransform, octant.yTransform, point, region, visMap);
+}
+
+/// @brief Fixed layouts: seeded regions of every type, at the largest room size and at the FOV's reach
+///
+/// @param pool Pool the regions' creatures would come from
+///
+/// @return The regions (owned by the caller)
+std::vector<Region *> makeLayouts(const CreaturePool * pool) {
+	std::vector<Region *> layouts;
+	const RoomType types[] = {RoomType::Room, RoomType::Corridor, RoomType::Spiral};
+	const int sizes[] = {MAX_ROOM_DIMENSION, FOV_DIAMETER};
+	for (RoomType type : types)
+		for (int size : sizes)
+			for (unsigned int seed = 0; seed < BENCH_SEEDS; seed++) {
+				std::mt19937 rng(seed);
+				layouts.push_back(new Region(size, size, type, pool, rng));
+			}
+	return layouts;
+}
+
+/// @brief Time each octant of the FOV with the templated kernel and the lambdas it replaced, from every tile of every layout
+///
+/// The two run within noise of each other (0.95x to 1.11x); what the kernel saves is the allocations, not time per cell
+///
+/// @param engine The engine
+/// @param layouts The layouts
+/// @param repeats Times to go over the layouts
+///
+/// @return The number of cells the two kernels disagree on
+unsigned long benchFOV(Engine & engine, const std::vector<Region *> & layouts, int repeats) {
+	VisibilityGrid lambdaView;
+	VisibilityGrid kernelView;
+	unsigned long mismatches = 0;
+	unsigned long origins = 0;
+	for (Region * region : layouts)
+		for (int x = 0; x < region->Width(); x++)
+			for (int y = 0; y < region->Height(); y++) {
+				origins++;
+				for (const OctantBench & octant : octants) {
+					lambdaView.clear();
+					kernelView.clear();
+					runLambda(engine, octant, Point(x, y), region, lambdaView);
+					octant.kernel(engine, Point(x, y), region, kernelView);
+					for (int cell = 0; cell < FOV_DIAMETER * FOV_DIAMETER; cell++) {
+						Point p = VisibilityGrid::cellPoint(cell);
+						if (!sameCell(lambdaView[p], kernelView[p])) {
+							if (mismatches == 0)
+								fprintf(stderr, "FOV %s from %d, %d in a %dx%d region of type %d: cell %d, %d differs\n",
+										octant.name, x, y, region->Width(), region->Height(), (int)region->Type(), p.first, p.second);
+							mismatches++;
+						}
+					}
+				}
+			}
+
+	printf("FOV, per octant (%lu origins over %lu layouts, %d repeats):\n", origins, (unsigned long)layouts.size(), repeats);
+	double calls = (double)origins * repeats;
+	for (const OctantBench & octant : octants) {
+		auto started = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+			for (Region * region : layouts)
+				for (int x = 0; x < region->Width(); x++)
+					for (int y = 0; y < region->Height(); y++)
+						runLambda(engine, octant, Point(x, y), region, lambdaView);
+		double lambdaSeconds = secondsSince(started);
+		started = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+			for (Region * region : layouts)
+				for (int x = 0; x < region->Width(); x++)
+					for (int y = 0; y < region->Height(); y++)
+						octant.kernel(engine, Point(x, y), region, kernelView);
+		double kernelSeconds = secondsSince(started);
+		printf("\t%s: lambda %8.2f us, kernel %8.2f us (%.2fx)\n", octant.name,
+				1e6 * lambdaSeconds / calls, 1e6 * kernelSeconds / calls,
+				(kernelSeconds > 0) ? lambdaSeconds / kernelSeconds : 0.0);
+	}
+	printf("%s: templated kernel sees the same cells as the lambdas (%lu mismatches)\n", mismatches ? "FAIL" : "PASS", mismatches);
+	return mismatches;
+}
+
+/// @brief One search to make: a grid and the points to go between
+///
+/// @tparam Grid Grid access policy
+template <typename Grid>
+struct SearchCase {
+	/// @brief The grid
+	Grid grid;
+	/// @brief The starting point
+	Point start;
+	/// @brief The ending point
+	Point finish;
+};
+
+/// @brief Follow a path over a grid, pricing it with a cost policy
+///
+/// @tparam Grid Grid access policy
+/// @tparam Cost Cost policy
+/// @tparam Path Container of steps, last step first
+/// @param search The search the path was found for
+/// @param cost The cost policy
+/// @param path The path (consumed)
+///
+/// @return The cost, or -1 if the path steps onto anything impassable or doesn't end at the finish
+template <typename Grid, typename Cost, typename Path>
+double pathCost(const SearchCase<Grid> & search, const Cost & cost, Path path) {
+	double total = 0;
+	Point at = search.start;
+	while (!path.empty()) {
+		Point step = DISPLACEMENT(path.back());
+		path.pop_back();
+		at = PAIR_SUM(at, step);
+		if (!search.grid.passable(at))
+			return -1;
+		total += ((step.first != 0 && step.second != 0) ? DIAGONAL_COST : 1) + cost.enter(search.grid.at(at));
+	}
+	return (at == search.finish) ? total : -1;
+}
+
+/// @brief The benchmark shared by every specialisation of the searches: make every search once, keeping the paths, then time them
+///
+/// @tparam Path Container the specialisation fills
+/// @tparam Grid Grid access policy
+/// @tparam Search Callable as bool(const SearchCase<Grid>&, PathWorkspace&, Path&, unsigned long& expanded)
+/// @param name Name of the specialisation
+/// @param searches The searches
+/// @param workspace Search storage big enough for the grids
+/// @param repeats Times to make every search
+/// @param search The specialisation
+/// @param paths Set to the path found for each search (empty if none was)
+///
+/// @return The number of paths found that don't lead to their finish
+template <typename Path, typename Grid, typename Search>
+unsigned long benchSearch(const char * name, const std::vector<SearchCase<Grid> > & searches, PathWorkspace & workspace, int repeats, Search search, std::vector<Path> & paths) {
+	unsigned long expanded = 0;
+	unsigned long found = 0;
+	unsigned long broken = 0;
+	paths.assign(searches.size(), Path());
+	for (std::size_t i = 0; i < searches.size(); i++) {
+		if (!search(searches[i], workspace, paths[i], expanded))
+			continue;
+		found++;
+		if (pathCost(searches[i], UniformCost(), paths[i]) < 0) {
+			if (broken == 0)
+				fprintf(stderr, "%s: the path from %d, %d to %d, %d doesn't lead there\n", name,
+						searches[i].start.first, searches[i].start.second, searches[i].finish.first, searches[i].finish.second);
+			broken++;
+		}
+	}
+
+	Path path;
+	unsigned long timedExpanded = 0;
+	auto started = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++)
+		for (const SearchCase<Grid> & s : searches)
+			search(s, workspace, path, timedExpanded);
+	double seconds = secondsSince(started);
+	double n = searches.empty() ? 1.0 : (double)searches.size();
+	printf("\t%-14s %8.2f us/search, %8.1f expanded/search, %lu of %lu found\n", name,
+			1e6 * seconds / (n * MAX(repeats, 1)), expanded / n, found, (unsigned long)searches.size());
+	return broken;
+}
+
+/// @brief Grid access policy: a synthetic grid of open ground and pillars, far bigger than any region
+class OpenGrid {
+	private:
+		/// @brief Width of the grid
+		int width;
+
+		/// @brief Height of the grid
+		int height;
+
+		/// @brief Whether each cell is a pillar, row-major (not owned)
+		const std::vector<bool> * pillars;
+
+	public:
+		/// @brief Constructor
+		///
+		/// @param width Width of the grid
+		/// @param height Height of the grid
+		/// @param pillars Whether each cell is a pillar, row-major (not owned)
+		OpenGrid(int width, int height, const std::vector<bool> * pillars) : width(width), height(height), pillars(pillars) {}
+
+		/// @brief Whether a point can be searched at all
+		///
+		/// @param point The point
+		///
+		/// @return True if on the grid
+		inline bool contains(const Point& point) const {
+			return point.first >= 0 && point.first < width && point.second >= 0 && point.second < height;
+		}
+
+		/// @brief Whether a point can be stepped onto
+		///
+		/// @param point The point
+		///
+		/// @return True if on the grid and not a pillar
+		inline bool passable(const Point& point) const {
+			return contains(point) && !(*pillars)[index(point)];
+		}
+
+		/// @brief What is seen at a point; nothing is ever there
+		///
+		/// @return An unseen cell
+		inline const Visibility& at(const Point&) const {
+			return VisibilityGrid::unseen;
+		}
+
+		/// @brief Translate a point to its index in the search workspace
+		///
+		/// @param point The point
+		///
+		/// @return The index
+		inline int index(const Point& point) const {
+			return point.second * width + point.first;
+		}
+
+		/// @brief Translate an index in the search workspace back to its point
+		///
+		/// @param index The index
+		///
+		/// @return The point
+		inline Point point(int index) const {
+			return Point(index % width, index / width);
+		}
+};
+
+/// @brief Count the searches two specialisations disagree on: one finding a path where the other doesn't, or a path of another length
+///
+/// @tparam Grid Grid access policy
+/// @tparam PathA Container of the first specialisation
+/// @tparam PathB Container of the second
+/// @param searches The searches
+/// @param a Paths of the first specialisation
+/// @param b Paths of the second
+///
+/// @return The number of disagreements
+template <typename Grid, typename PathA, typename PathB>
+unsigned long lengthDisagreements(const std::vector<SearchCase<Grid> > & searches, const std::vector<PathA> & a, const std::vector<PathB> & b) {
+	unsigned long disagreements = 0;
+	for (std::size_t i = 0; i < searches.size(); i++) {
+		double lengthA = pathCost(searches[i], UniformCost(), a[i]);
+		double lengthB = pathCost(searches[i], UniformCost(), b[i]);
+		if (a[i].empty() != b[i].empty() || ABS(lengthA - lengthB) > COST_EPSILON) {
+			if (disagreements == 0)
+				fprintf(stderr, "Searches from %d, %d to %d, %d disagree: %.3f against %.3f long\n",
+						searches[i].start.first, searches[i].start.second, searches[i].finish.first, searches[i].finish.second,
+						lengthA, lengthB);
+			disagreements++;
+		}
+	}
+	return disagreements;
+}
+
+/// @brief Fields of view taken across the layouts, with monsters placed in them, and searches from the middle of each to open cells in sight
+///
+/// @param engine The engine
+/// @param layouts The layouts
+/// @param views Set to the fields of view
+/// @param searches Set to the searches, over views
+void makeViewSearches(Engine & engine, const std::vector<Region *> & layouts, std::vector<VisibilityGrid> & views, std::vector<SearchCase<ViewGrid> > & searches) {
+	std::vector<std::pair<Region *, Point> > origins;
+	for (Region * region : layouts)
+		for (int x = 1; x < region->Width(); x += SEARCH_ORIGIN_SPACING)
+			for (int y = 1; y < region->Height(); y += SEARCH_ORIGIN_SPACING)
+				if (bkgrProps.at(region->getBackground(Point(x, y))).passible)
+					origins.push_back(std::make_pair(region, Point(x, y)));
+	// Sized up front, so the searches can hold on to them
+	views.assign(origins.size(), VisibilityGrid());
+	searches.clear();
+	for (std::size_t i = 0; i < origins.size(); i++) {
+		VisibilityGrid & view = views[i];
+		EngineBench::view(engine, origins[i].second, origins[i].first, view);
+		int open = 0;
+		for (int cell = 0; cell < FOV_DIAMETER * FOV_DIAMETER; cell++) {
+			Point p = VisibilityGrid::cellPoint(cell);
+			if (p == Point(0, 0) || !view[p].visible || !bkgrProps.at(view[p].background).passible)
+				continue;
+			open++;
+			if (open % SEARCH_MONSTER_SPACING == 0) {
+				Visibility monster = view[p];
+				monster.team = Team::Monsters;
+				view.set(p, monster);
+			}
+			if (open % SEARCH_TARGET_SPACING == 0)
+				searches.push_back({ViewGrid(view), Point(0, 0), p});
+		}
+	}
+}
+
+/// @brief Time the specialisations of gridSearch the engine uses over the same searches, and check they agree
+///
+/// The player's click-to-move (UniformCost, into a PathBuffer) must find the shortest paths; a monster's chase (TeamCost for the monsters, into a vector) must find a path for exactly the same
+/// searches, no shorter, and no dearer by its own costs
+///
+/// @param engine The engine
+/// @param layouts The layouts
+/// @param repeats Times to make every search
+///
+/// @return The number of failed checks
+unsigned long benchSearches(Engine & engine, const std::vector<Region *> & layouts, int repeats) {
+	std::vector<VisibilityGrid> views;
+	std::vector<SearchCase<ViewGrid> > searches;
+	makeViewSearches(engine, layouts, views, searches);
+	PathWorkspace workspace;
+	unsigned long failures = 0;
+
+	printf("Searches over fields of view (%lu searches in %lu views, %d repeats):\n", (unsigned long)searches.size(), (unsigned long)views.size(), repeats);
+	std::vector<PathBuffer> clicks;
+	failures += benchSearch("player click", searches, workspace, repeats,
+			[](const SearchCase<ViewGrid> & s, PathWorkspace & ws, PathBuffer & path, unsigned long & expanded) {
+				return gridSearch(s.grid, UniformCost(), s.start, s.finish, ws, path, expanded);
+			}, clicks);
+	std::vector<std::vector<Direction> > chases;
+	failures += benchSearch("monster chase", searches, workspace, repeats,
+			[](const SearchCase<ViewGrid> & s, PathWorkspace & ws, std::vector<Direction> & path, unsigned long & expanded) {
+				return gridSearch(s.grid, TeamCost{Team::Monsters}, s.start, s.finish, ws, path, expanded);
+			}, chases);
+
+	unsigned long disagreements = 0;
+	for (std::size_t i = 0; i < searches.size(); i++) {
+		const TeamCost chase = {Team::Monsters};
+		double clickLength = pathCost(searches[i], UniformCost(), clicks[i]);
+		double chaseLength = pathCost(searches[i], UniformCost(), chases[i]);
+		bool agree = (clicks[i].empty() == chases[i].empty()) && clickLength <= chaseLength + COST_EPSILON
+			&& pathCost(searches[i], chase, chases[i]) <= pathCost(searches[i], chase, clicks[i]) + COST_EPSILON;
+		if (!agree) {
+			if (disagreements == 0)
+				fprintf(stderr, "Searches from %d, %d to %d, %d disagree: click %.3f, chase %.3f long\n",
+						searches[i].start.first, searches[i].start.second, searches[i].finish.first, searches[i].finish.second,
+						clickLength, chaseLength);
+			disagreements++;
+		}
+	}
+	failures += disagreements;
+	printf("%s: the specialisations find valid paths and agree on cost (%lu failures)\n", failures ? "FAIL" : "PASS", failures);
+	return failures;
+}
+
+/// @brief Time Jump Point Search against A* with every step costing its length, and check they find paths of the same length
+///
+/// Searches are made in fields of view across rooms of the largest size, and across synthetic grids far bigger than any room,
+/// open and with scattered pillars
+///
+/// @param engine The engine
+/// @param layouts The layouts
+/// @param repeats Times to make every search
+///
+/// @return The number of failed checks
+unsigned long benchJumpPoints(Engine & engine, const std::vector<Region *> & layouts, int repeats) {
+	unsigned long failures = 0;
+
+	std::vector<Region *> rooms;
+	for (Region * region : layouts)
+		if (region->Type() == RoomType::Room && region->Width() == MAX_ROOM_DIMENSION)
+			rooms.push_back(region);
+	std::vector<VisibilityGrid> views;
+	std::vector<SearchCase<ViewGrid> > viewSearches;
+	makeViewSearches(engine, rooms, views, viewSearches);
+	PathWorkspace viewspace;
+	printf("Jump Point Search in %dx%d rooms (%lu searches in %lu views, %d repeats):\n", MAX_ROOM_DIMENSION, MAX_ROOM_DIMENSION,
+			(unsigned long)viewSearches.size(), (unsigned long)views.size(), repeats);
+	std::vector<PathBuffer> viewAstar;
+	failures += benchSearch("A*", viewSearches, viewspace, repeats,
+			[](const SearchCase<ViewGrid> & s, PathWorkspace & ws, PathBuffer & path, unsigned long & expanded) {
+				return gridSearch(s.grid, UniformCost(), s.start, s.finish, ws, path, expanded);
+			}, viewAstar);
+	std::vector<PathBuffer> viewJump;
+	failures += benchSearch("jump point", viewSearches, viewspace, repeats,
+			[](const SearchCase<ViewGrid> & s, PathWorkspace & ws, PathBuffer & path, unsigned long & expanded) {
+				return jumpPointSearch(s.grid, s.start, s.finish, ws, path, expanded);
+			}, viewJump);
+	failures += lengthDisagreements(viewSearches, viewAstar, viewJump);
+
+	const int sizes[] = {64, 256, 512};
+	const double densities[] = {0.0, 0.02};
+	for (int size : sizes)
+		for (double density : densities) {
+			std::mt19937 rng(size);
+			std::bernoulli_distribution pillar(density);
+			std::uniform_int_distribution<int> coord(0, size - 1);
+			std::vector<bool> pillars((std::size_t)size * size);
+			for (std::size_t i = 0; i < pillars.size(); i++)
+				pillars[i] = pillar(rng);
+			OpenGrid grid(size, size, &pillars);
+			std::vector<SearchCase<OpenGrid> > searches;
+			searches.push_back({grid, Point(0, 0), Point(size - 1, size - 1)});
+			searches.push_back({grid, Point(size - 1, 0), Point(0, size / 2)});
+			while (searches.size() < GRID_SEARCHES + 2) {
+				Point start(coord(rng), coord(rng));
+				Point finish(coord(rng), coord(rng));
+				if (start != finish)
+					searches.push_back({grid, start, finish});
+			}
+			for (const SearchCase<OpenGrid> & s : searches) {
+				pillars[grid.index(s.start)] = false;
+				pillars[grid.index(s.finish)] = false;
+			}
+
+			PathWorkspace gridspace(pillars.size());
+			printf("Jump Point Search on a %dx%d grid, %.0f%% pillars (%lu searches, %d repeats):\n", size, size, 100 * density,
+					(unsigned long)searches.size(), repeats);
+			std::vector<std::vector<Direction> > astarPaths;
+			failures += benchSearch("A*", searches, gridspace, repeats,
+					[](const SearchCase<OpenGrid> & s, PathWorkspace & ws, std::vector<Direction> & path, unsigned long & expanded) {
+						return gridSearch(s.grid, UniformCost(), s.start, s.finish, ws, path, expanded);
+					}, astarPaths);
+			std::vector<std::vector<Direction> > jumpPaths;
+			failures += benchSearch("jump point", searches, gridspace, repeats,
+					[](const SearchCase<OpenGrid> & s, PathWorkspace & ws, std::vector<Direction> & path, unsigned long & expanded) {
+						return jumpPointSearch(s.grid, s.start, s.finish, ws, path, expanded);
+					}, jumpPaths);
+			failures += lengthDisagreements(searches, astarPaths, jumpPaths);
+		}
+	printf("%s: Jump Point Search finds paths as short as A* (%lu failures)\n", failures ? "FAIL" : "PASS", failures);
+	return failures;
+}
+
+/// @brief Time the engine's kernels and check them against what they replaced
+int main(int argc, char* argv[]) {
+	int repeats = BENCH_REPEATS;
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && strcmp(argv[i], "-r") == 0)
+			repeats = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "Usage: %s [-r repeats]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	Engine engine(1, 1);
+	CreaturePool pool;
+	std::vector<Region *> layouts = makeLayouts(&pool);
+	unsigned long failures = 0;
+	failures += benchFOV(engine, layouts, repeats);
+	failures += benchSearches(engine, layouts, repeats);
+	failures += benchJumpPoints(engine, layouts, repeats);
+	for (Region * region : layouts)
+		delete region;
+	return failures ? 1 : 0;
+}
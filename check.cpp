@@ -0,0 +1,428 @@
+#include <cstdio>
+#include <cstdint>
+#include <random>
+
+#include "creature.h"
+#include "engine.h"
+#include "region.h"
+#include "worldfile.h"
+
+/// @brief Seeds each region check is repeated with
+#define CHECK_SEEDS 20
+
+/// @brief How far outside a region the probes reach
+#define PROBE_MARGIN 4
+
+/// @brief Games played to check that regions out of reach are dropped
+#define DISCARD_GAMES 8
+
+/// @brief Turns each of those games is played for, at most
+#define DISCARD_TURNS 1500
+
+/// @brief Rolls a creature makes before it is written out, and after it is read back
+#define RECORD_ROLLS 100
+
+/// @brief Games played with and without paging, to check that paging can't be told apart
+#define PAGING_GAMES 8
+
+/// @brief Turns each of those games is played for, at most
+#define PAGING_TURNS 1500
+
+/// @brief Games played to check travel through regions dropped from memory
+#define TRAVEL_GAMES 8
+
+/// @brief Turns each of those games is walked for, at most, looking for such a travel
+#define TRAVEL_TURNS 1500
+
+/// @brief Turns walked between looks for such a travel
+#define TRAVEL_EVERY 10
+
+/// @brief How far away travel destinations are tried, at most, in each of the eight directions
+#define TRAVEL_REACH 60
+
+/// @brief Spacing of the destinations tried along each direction
+#define TRAVEL_SPACING 4
+
+/// @brief Steps a travel may take before it is counted as lost
+#define TRAVEL_STEPS 400
+
+/// @brief Reaches into Region for the checks
+class RegionProbe {
+	public:
+		/// @brief The number of tiles stored, including the border
+		///
+		/// @param region The region
+		///
+		/// @return The count
+		static std::size_t tiles(const Region & region) {
+			return region.points.size();
+		}
+
+		/// @brief The number of cells the item store is sized for
+		///
+		/// @param region The region
+		///
+		/// @return The count
+		static std::size_t itemCells(const Region & region) {
+			return region.items.size();
+		}
+
+		/// @brief The memory held by the item store
+		///
+		/// @param region The region
+		///
+		/// @return The number of bytes
+		static std::size_t itemBytes(const Region & region) {
+			return region.items.footprint();
+		}
+
+		/// @brief Try to add a door at every point on and around the walls, in every direction, and a run of random ones
+		///
+		/// @param region The region
+		/// @param rng Random number engine for the random doors
+		static void probeDoors(Region & region, std::mt19937 & rng) {
+			for (uint8_t d = (uint8_t)Direction::Up; d <= (uint8_t)Direction::Down; d++) {
+				for (int x = -PROBE_MARGIN; x < region.width + PROBE_MARGIN; x++)
+					for (int y = -PROBE_MARGIN; y < region.height + PROBE_MARGIN; y++)
+						region.addrandomemptyconnection((Direction)d, Point(x, y));
+				for (int i = 0; i < 4 + (region.width + region.height) / 2; i++)
+					region.addrandomemptyconnection((Direction)d, rng);
+			}
+			// Directions that aren't door directions are refused
+			region.addrandomemptyconnection(Direction::UpLeft, rng);
+			region.addrandomemptyconnection(Direction::NONE, Point(-1, 0));
+		}
+};
+
+/// @brief Reaches into Engine for the checks
+class EngineProbe {
+	public:
+		/// @brief Which regions are in memory
+		///
+		/// @param engine The engine
+		///
+		/// @return Whether each region record has a resident region, by id
+		static std::vector<bool> residents(const Engine & engine) {
+			std::vector<bool> resident;
+			for (const Engine::RegionRecord & record : engine.regionRecords)
+				resident.push_back(record.resident != NULL);
+			return resident;
+		}
+
+		/// @brief The regions the current travel goes through
+		///
+		/// @param engine The engine
+		///
+		/// @return Their ids, from the destination's back to the player's
+		static std::vector<unsigned int> route(const Engine & engine) {
+			std::vector<unsigned int> ids;
+			for (const Region * region : engine.travelRoute)
+				ids.push_back(region->id);
+			return ids;
+		}
+
+		/// @brief Where the current travel ends
+		///
+		/// @param engine The engine
+		///
+		/// @return The region's id and the point in it
+		static std::pair<unsigned int, Point> destination(const Engine & engine) {
+			return {engine.travelRegion->id, engine.travelGoal};
+		}
+
+		/// @brief Drop regions out of reach from memory now, as the engine does every REGION_DISCARD_TURNS turns
+		///
+		/// @param engine The engine
+		static void dropOutOfReach(Engine & engine) {
+			engine.dropOutOfReach();
+		}
+
+		/// @brief Where the player is
+		///
+		/// @param engine The engine
+		///
+		/// @return The region's id and the point in it
+		static std::pair<unsigned int, Point> player(const Engine & engine) {
+			return {engine.player->getRegion()->id, engine.player->getPosition()};
+		}
+};
+
+/// @brief Make the same queries FOV and relBaF make, including well outside the region
+///
+/// @param region The region
+void probeQueries(Region & region) {
+	for (int x = -PROBE_MARGIN; x < region.Width() + PROBE_MARGIN; x++)
+		for (int y = -PROBE_MARGIN; y < region.Height() + PROBE_MARGIN; y++) {
+			Point p(x, y);
+			region.getBackground(p);
+			region.getForeground(p);
+			region.topItem(p);
+			region.hasCreature(p);
+			region.connectionAt(p);
+			region.itemHereString(p);
+		}
+}
+
+/// @brief Door placement and read-only queries must never grow a region's storage
+///
+/// @return The number of failures
+int checkRegionStorage() {
+	int failures = 0;
+	int checked = 0;
+	CreaturePool pool;
+	const RoomType types[] = {RoomType::Room, RoomType::Corridor, RoomType::Spiral};
+	for (RoomType type : types)
+		for (int w = 1; w <= MAX_ROOM_DIMENSION * 2; w++)
+			for (int h = 1; h <= MAX_ROOM_DIMENSION * 2; h++)
+				for (unsigned int seed = 0; seed < CHECK_SEEDS; seed++) {
+					std::mt19937 rng(seed);
+					Region region(w, h, type, &pool, rng);
+					std::size_t expected = (std::size_t)(w + 2) * (h + 2);
+					std::size_t cells = RegionProbe::itemCells(region);
+					std::size_t itemBytes = RegionProbe::itemBytes(region);
+					RegionProbe::probeDoors(region, rng);
+					probeQueries(region);
+					checked++;
+					if (RegionProbe::tiles(region) != expected || cells != expected
+							|| RegionProbe::itemCells(region) != cells || RegionProbe::itemBytes(region) != itemBytes) {
+						if (failures == 0)
+							fprintf(stderr, "type %d, %dx%d, seed %u: %lu tiles (expected %lu), %lu item cells (was %lu), %lu item bytes (was %lu)\n",
+									(int)type, w, h, seed,
+									(unsigned long)RegionProbe::tiles(region), (unsigned long)expected,
+									(unsigned long)RegionProbe::itemCells(region), (unsigned long)cells,
+									(unsigned long)RegionProbe::itemBytes(region), (unsigned long)itemBytes);
+						failures++;
+					}
+				}
+	printf("%s: region storage stays (w+2)*(h+2) tiles through door probes and queries (%d regions)\n", failures ? "FAIL" : "PASS", checked);
+	return failures;
+}
+
+/// @brief Take one turn of a random walk, picking up anything underfoot, as ascentbatch does
+///
+/// @param engine The engine
+/// @param policy Random number engine for the walk
+void walkStep(Engine & engine, std::mt19937 & policy) {
+	std::uniform_int_distribution<int> dirdist(0, 7);
+	if (engine.underWitch() != Foreground::NONE && engine.Act({ActionType::Pickup, Direction::NONE, '\0'}))
+		return;
+	bool moved = false;
+	for (int i = 0; i < 8 && !moved; i++)
+		moved = engine.Act({ActionType::Move, (Direction)dirdist(policy), '\0'});
+	if (!moved)
+		engine.Act({ActionType::NONE, Direction::NONE, '\0'});
+}
+
+/// @brief Play a game with a random walk, picking up anything underfoot, as ascentbatch does
+///
+/// @param engine The engine
+/// @param seed Seed for the walk
+/// @param maxTurns The most turns to play
+void randomWalk(Engine & engine, std::mt19937::result_type seed, unsigned long maxTurns) {
+	std::mt19937 policy(seed);
+	while (engine.playerAlive() && engine.getStats().turns < maxTurns)
+		walkStep(engine, policy);
+}
+
+/// @brief Regions left behind must actually be dropped and regenerated, with monsters moving about in them
+///
+/// @return The number of failures
+int checkDiscards() {
+	unsigned long discarded = 0;
+	unsigned long restored = 0;
+	unsigned long turns = 0;
+	unsigned long brokenDoors = 0;
+	for (std::mt19937::result_type seed = 1; seed <= DISCARD_GAMES; seed++) {
+		Engine engine(1, seed);
+		randomWalk(engine, seed, DISCARD_TURNS);
+		discarded += engine.getStats().regionsDiscarded;
+		restored += engine.getStats().regionsRestored;
+		turns += engine.getStats().turns;
+		brokenDoors += engine.getStats().brokenDoors;
+	}
+	bool pass = discarded > 0 && restored > 0 && brokenDoors == 0;
+	printf("%s: regions out of reach are discarded and regenerated (%lu discarded, %lu restored over %d games, %lu turns, %lu broken doors)\n",
+			pass ? "PASS" : "FAIL", discarded, restored, DISCARD_GAMES, turns, brokenDoors);
+	return pass ? 0 : 1;
+}
+
+/// @brief A creature read back from its record must go on rolling the same dice as the one written out
+///
+/// @return The number of failures
+int checkCreatureRecords() {
+	int failures = 0;
+	for (unsigned int seed = 0; seed < CHECK_SEEDS; seed++) {
+		Creature original(Point(1, 1), NULL, CreatureType::Rat, Team::Monsters, seed);
+		// A different number of rolls each time, so that both dice have been part way through the engine's state
+		for (unsigned int i = 0; i < seed * RECORD_ROLLS / CHECK_SEEDS; i++) {
+			original.rollToAttack();
+			original.rollWeapon();
+		}
+		RecordWriter out;
+		original.save(out);
+		RecordReader in(out.data().data(), out.data().size());
+		Creature restored(in, NULL);
+		int differing = 0;
+		for (int i = 0; i < RECORD_ROLLS; i++) {
+			if (original.rollToAttack() != restored.rollToAttack())
+				differing++;
+			if (original.rollWeapon() != restored.rollWeapon())
+				differing++;
+		}
+		if (differing != 0) {
+			if (failures == 0)
+				fprintf(stderr, "seed %u: %d of %d rolls differ after a creature is read back\n", seed, differing, 2 * RECORD_ROLLS);
+			failures++;
+		}
+	}
+	printf("%s: creatures read back from a record roll the same dice (%d creatures)\n", failures ? "FAIL" : "PASS", CHECK_SEEDS);
+	return failures;
+}
+
+/// @brief Sum up the state of a game as the player sees it, along with how the monsters got there
+///
+/// @param engine The engine
+///
+/// @return The fingerprint
+uint64_t fingerprint(Engine & engine) {
+	uint64_t hash = 1469598103934665603ULL;
+	auto mix = [&hash](uint64_t value) {
+		hash = (hash ^ value) * 1099511628211ULL;
+	};
+	const EngineStats & stats = engine.getStats();
+	mix(stats.turns);
+	mix(stats.monsterTurns);
+	mix(stats.regionsGenerated);
+	mix(engine.totalSearchExpansions());
+	mix(engine.playerAlive());
+	mix((uint64_t)engine.playerHP());
+	mix(engine.getPlayerInventory().total(ItemType::Gold));
+	mix((uint64_t)(uint32_t)engine.getCurrentPosition().first);
+	mix((uint64_t)(uint32_t)engine.getCurrentPosition().second);
+	for (int x = -FOV_RADIUS; x <= FOV_RADIUS; x++)
+		for (int y = -FOV_RADIUS; y <= FOV_RADIUS; y++) {
+			mix((uint64_t)engine.getBackground(Point(x, y)));
+			mix((uint64_t)engine.getForeground(Point(x, y)));
+		}
+	return hash;
+}
+
+/// @brief Paging regions out and back in must not change how a game plays out
+///
+/// @return The number of failures
+int checkPaging() {
+	int failures = 0;
+	unsigned long pagedOut = 0;
+	unsigned long pagedIn = 0;
+	for (std::mt19937::result_type seed = 1; seed <= PAGING_GAMES; seed++) {
+		Engine resident(1, seed);
+		resident.setResidentBudget(SIZE_MAX);
+		randomWalk(resident, seed, PAGING_TURNS);
+		Engine paging(1, seed);
+		// Everything out of reach is paged out as soon as it can be
+		paging.setResidentBudget(0);
+		randomWalk(paging, seed, PAGING_TURNS);
+		pagedOut += paging.getStats().regionsPagedOut;
+		pagedIn += paging.getStats().regionsPagedIn;
+		if (resident.getStats().regionsPagedOut != 0 || fingerprint(resident) != fingerprint(paging)) {
+			if (failures == 0)
+				fprintf(stderr, "seed %u: %lu turns and %lu monster turns with every region resident, %lu and %lu with paging\n", (unsigned int)seed,
+						resident.getStats().turns, resident.getStats().monsterTurns, paging.getStats().turns, paging.getStats().monsterTurns);
+			failures++;
+		}
+	}
+	if (pagedOut == 0 || pagedIn == 0)
+		failures++;
+	printf("%s: paging regions out and back in doesn't change the game (%lu paged out, %lu paged in over %d games)\n",
+			failures ? "FAIL" : "PASS", pagedOut, pagedIn, PAGING_GAMES);
+	return failures;
+}
+
+/// @brief Look for a travel destination whose route goes through a region that is out of memory, on the way to it, and travel there
+///
+/// @param engine The engine
+///
+/// @return -1 if there was no such destination, 1 if the player arrived, 0 if the travel was lost or its route dropped on the way
+int travelThroughDropped(Engine & engine) {
+	for (int reach = TRAVEL_SPACING; reach <= TRAVEL_REACH; reach += TRAVEL_SPACING)
+		for (uint8_t d = (uint8_t)Direction::Up; d <= (uint8_t)Direction::UpLeft; d++) {
+			std::vector<bool> resident = EngineProbe::residents(engine);
+			if (!engine.beginTravel(PAIR_MULTIPLY(DISPLACEMENT((Direction)d), Point(reach, reach))))
+				continue;
+			// The destination itself never counts; it has to be a region on the way
+			std::vector<unsigned int> route = EngineProbe::route(engine);
+			bool dropped = false;
+			for (std::size_t i = 1; i < route.size(); i++)
+				if (route[i] < resident.size() && !resident[route[i]])
+					dropped = true;
+			if (!dropped) {
+				engine.cancelTravel();
+				continue;
+			}
+			std::pair<unsigned int, Point> destination = EngineProbe::destination(engine);
+			// Whatever the search brought back is out of reach again, so it would go straight away unless kept for the travel
+			EngineProbe::dropOutOfReach(engine);
+			bool kept = true;
+			for (int step = 0; step < TRAVEL_STEPS && engine.travelling() && engine.playerAlive() && kept; step++) {
+				resident = EngineProbe::residents(engine);
+				for (unsigned int id : route)
+					if (!resident[id])
+						kept = false;
+				Direction direction = engine.travelStep();
+				if (direction == Direction::NONE)
+					break;
+				// Monsters in the way are fought, as the game does when a travel step is taken
+				engine.Act({ActionType::Move, direction, '\0'});
+			}
+			engine.cancelTravel();
+			return (kept && (EngineProbe::player(engine) == destination || !engine.playerAlive())) ? 1 : 0;
+		}
+	return -1;
+}
+
+/// @brief Travel must find its way through regions that were dropped from memory or paged out, and keep its route in memory until it arrives
+///
+/// @return The number of failures
+int checkTravel() {
+	int travels = 0;
+	int lost = 0;
+	for (std::mt19937::result_type seed = 1; seed <= TRAVEL_GAMES; seed++) {
+		Engine engine(1, seed);
+		// Everything out of reach is paged out as soon as it can be
+		engine.setResidentBudget(0);
+		std::mt19937 policy(seed);
+		int result = -1;
+		while (result == -1 && engine.playerAlive() && engine.getStats().turns < TRAVEL_TURNS) {
+			walkStep(engine, policy);
+			if (engine.getStats().turns % TRAVEL_EVERY == 0)
+				result = travelThroughDropped(engine);
+		}
+		if (result == -1)
+			continue;
+		travels++;
+		if (result == 0) {
+			if (lost == 0)
+				fprintf(stderr, "seed %u: travel through a dropped region didn't arrive, or lost a region on its route\n", (unsigned int)seed);
+			lost++;
+		}
+	}
+	int failures = lost + (travels == 0 ? 1 : 0);
+	printf("%s: travel goes through regions dropped from memory (%d of %d travels arrived over %d games)\n",
+			failures ? "FAIL" : "PASS", travels - lost, travels, TRAVEL_GAMES);
+	return failures;
+}
+
+/// @brief Run every check
+int main() {
+	int failures = 0;
+	failures += checkRegionStorage();
+	failures += checkDiscards();
+	failures += checkCreatureRecords();
+	failures += checkPaging();
+	failures += checkTravel();
+	if (failures != 0) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	return 0;
+}
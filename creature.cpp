@@ -1,5 +1,5 @@
 #include "creature.h"
-#include <stack>
+#include "search.h"
 #include <cassert>
 #include <sstream>
 #include <iostream>
@@ -9,132 +9,193 @@ Foreground getCreaturePointerForeground(Creature* creature) {
 	return getCreatureForeground(creature->getType());
 }
 
-Creature::Creature(Point position, Region * region, CreatureType type, Team team) {
+Creature::Creature(Point position, Region * region, CreatureType type, Team team, std::mt19937::result_type seed) {
 	this->position = position;
 	this->region = region;
 	this->type = type;
 	this->properties = getCreatureProperties(type);
 	this->team = team;
 	dweapon = std::uniform_int_distribution<int>(1, this->properties.attackDice);
-	std::random_device rd;
-	gen = std::mt19937(rd());
+	gen = ReplayableEngine(seed);
+}
+
+Creature::Creature(RecordReader & in, Region * region) {
+	this->region = region;
+	ReplayableEngine::result_type seed;
+	unsigned long long draws;
+	in.get(position);
+	in.get(type);
+	in.get(team);
+	in.get(seed);
+	in.get(draws);
+	in.get(properties);
+	for (int i = 0; i < 26 * 2; i++) {
+		inventory_entry_t & entry = inventory[INV_indextochar(i)];
+		in.get(entry.first);
+		in.get(entry.second);
+	}
+	in.get(target);
+	uint8_t planHere;
+	in.get(planHere);
+	planRegion = planHere ? region : NULL;
+	in.get(planOrigin);
+	in.get(planGoal);
+	uint32_t steps;
+	in.get(steps);
+	plan.resize(steps);
+	in.get(plan.data(), plan.size());
+	dweapon = std::uniform_int_distribution<int>(1, this->properties.attackDice);
+	gen = ReplayableEngine(seed, draws);
+}
+
+void Creature::save(RecordWriter & out) const {
+	out.put(position);
+	out.put(type);
+	out.put(team);
+	out.put(gen.seed());
+	out.put(gen.draws());
+	out.put(properties);
+	for (int i = 0; i < 26 * 2; i++) {
+		const inventory_entry_t & entry = inventory[INV_indextochar(i)];
+		out.put(entry.first);
+		out.put(entry.second);
+	}
+	out.put(target);
+	// A plan made elsewhere is searched for again anyway
+	out.put((uint8_t)(planRegion == region));
+	out.put(planOrigin);
+	out.put(planGoal);
+	out.put((uint32_t)plan.size());
+	out.put(plan.data(), plan.size());
 }
 
 Creature::~Creature() {
 
 }
 
-Direction Creature::propose_action() {
+Direction Creature::propose_action(PathWorkspace & workspace, const DistanceField * field) {
 	assert(cvismap != NULL);
 
+	lastExpanded = 0;
 	target = findTarget();
-	delete plan;
-	plan = astar({0,0}, target);
-	if (!plan->empty()) {
-		Direction nd = plan->front();
-		plan->pop();
+	// A hostile in sight can be chased down the shared field, if it is in this region
+	if (targetSighted && field != NULL && field->forRegion() == region) {
+		Direction nd = field->downhill(position);
+		if (nd != Direction::NONE) {
+			plan.clear();
+			planRegion = NULL;
+			return nd;
+		}
+	}
+	if (!repairPlan(workspace)) {
+		astar({0,0}, target, workspace, plan);
+		planRegion = region;
+		planGoal = PAIR_SUM(position, target);
+	}
+	if (!plan.empty()) {
+		Direction nd = plan.back();
+		plan.pop_back();
+		planOrigin = PAIR_SUM(position, DISPLACEMENT(nd));
 		return nd;
 	}
+	planOrigin = position;
 	return Direction::NONE;
 	
 }
 
-std::queue<Direction> * Creature::astar(Point start, Point finish) {
-	std::queue<Direction> * directions = new std::queue<Direction>;
-	if (!bkgrProps.at((*cvismap)[start].background).passible) {
-		return directions;
-	}
-	using movement_cost_t = double;
-	using move_t = std::pair<Point, Direction>;
-	using costandmove = std::pair<movement_cost_t, move_t>;
-
-	std::priority_queue<costandmove, std::vector<costandmove>, std::greater<costandmove> > fronteir;
-	fronteir.push( 
-			{
-				0.0,
-				{
-					start,
-					Direction::Up
-				} 
-			});
-
-	std::map<Point, move_t> came_from;
-	came_from[start] = {
-		start,
-		Direction::Up
+bool Creature::repairPlan(PathWorkspace & workspace) {
+	// Only a plan made here, in this region, and followed so far can be kept
+	if (planRegion != region || planOrigin != position || plan.empty())
+		return false;
+
+	Point goal = PAIR_SUM(position, target);
+	int n = (int)plan.size();
+	// The plan is stored last step first; forward step k is plan[n - 1 - k]
+	auto stepAt = [this, &n](int k) {
+		return plan[n - 1 - k];
+	};
+	auto passible = [this](const Point& cell) {
+		// Cells beyond the window can't be checked yet; assume they are still open
+		if (!VisibilityGrid::inBounds(cell))
+			return true;
+		return bkgrProps.at((*cvismap)[cell].background).passible;
 	};
-	std::map<Point, movement_cost_t> cost_so_far;
-	cost_so_far[start] = 0.0;
-
-	bool success = false;
-	while (!fronteir.empty()) {
-		auto current_state = fronteir.top();
-		Point current = current_state.second.first;
-		if (current == finish) {
-			success = true;
-		}
-		movement_cost_t current_cost = current_state.first;
-		fronteir.pop();
-		for (const auto & disp : displacementMap) {
-			move_t next = {
-				PAIR_SUM(disp.second, current),
-				disp.first
-			};
-			Visibility npvis = (*cvismap)[next.first];
-//			if (npvis.team == this->team)
-//				continue;
-			Background nb = npvis.background;
-			
-//			BaF nbaf = relBaF(next.first, relativeTo);
-			if (!bkgrProps.at(nb).passible)
-				continue;
-			movement_cost_t new_cost = ((disp.second.first != 0 && disp.second.second != 0) ? 1.41421356237 : 1) + ((npvis.team == this->team) ? 2 : 0) + current_cost;
-			if (cost_so_far.find(next.first) == cost_so_far.end()) {
-				fronteir.push(std::make_pair(new_cost, next));
-				came_from[next.first] = {
-					current,
-					disp.first
-				};
-				cost_so_far[next.first] = new_cost;
-			} else if (cost_so_far[next.first] > new_cost) {
-				fronteir.push(std::make_pair(new_cost, next));
-				came_from[next.first] = {
-					current,
-					disp.first
-				};
-				cost_so_far[next.first] = new_cost;
-				
-			}
 
+	// Retarget: a goal that is now on the path cuts the path short, one a step past its end extends it
+	if (goal != planGoal) {
+		Point cell = {0,0};
+		int k = 0;
+		for (; k < n && PAIR_SUM(position, cell) != goal; k++)
+			cell = PAIR_SUM(cell, DISPLACEMENT(stepAt(k)));
+		if (PAIR_SUM(position, cell) == goal) {
+			plan.erase(plan.begin(), plan.begin() + (n - k));
+			n = k;
+		} else {
+			Point delta = PAIR_SUBTRACT(goal, planGoal);
+			if (ABS(delta.first) > 1 || ABS(delta.second) > 1 || !passible(target))
+				return false;
+			Direction extra = Direction::NONE;
+			for (const auto & disp : displacementMap)
+				if (disp.second == delta)
+					extra = disp.first;
+			plan.insert(plan.begin(), extra);
+			n++;
 		}
-
-	}
-	if (!success)
-		return directions;
-
-	std::stack<Direction> rpath;
-	Point c2 = finish;
-	while (c2 != start) {
-		move_t cfm = came_from[c2];
-		c2 = cfm.first;
-		rpath.push(cfm.second);
+		planGoal = goal;
+		if (n == 0)
+			return true;
 	}
 
-	while (!rpath.empty()) {
-		directions->push(rpath.top());
-		rpath.pop();
+	// Repair: route around each blocked stretch of the path and splice the detour in
+	int repairs = 0;
+	Point cell = {0,0};
+	for (int k = 0; k < n; k++) {
+		Point next = PAIR_SUM(cell, DISPLACEMENT(stepAt(k)));
+		if (passible(next)) {
+			cell = next;
+			continue;
+		}
+		if (++repairs > MAX_PLAN_REPAIRS)
+			return false;
+		// Find the first open cell past the blockage
+		int m = k;
+		Point rejoin = next;
+		while (m < n - 1 && !passible(rejoin)) {
+			m++;
+			rejoin = PAIR_SUM(rejoin, DISPLACEMENT(stepAt(m)));
+		}
+		if (!passible(rejoin))
+			return false;
+		if (!astar(cell, rejoin, workspace, detour))
+			return false;
+		// New plan: steps after m, then the detour, then the k steps before the blockage
+		detour.insert(detour.begin(), plan.begin(), plan.begin() + (n - m - 1));
+		detour.insert(detour.end(), plan.begin() + (n - k), plan.end());
+		int detourLength = (int)detour.size() - (n - m - 1) - k;
+		plan.swap(detour);
+		n = (int)plan.size();
+		k += detourLength - 1;
+		cell = rejoin;
 	}
+	return true;
+}
 
-	return directions;
+bool Creature::astar(Point start, Point finish, PathWorkspace & workspace, std::vector<Direction> & path) {
+	return gridSearch(ViewGrid(*cvismap), TeamCost{team}, start, finish, workspace, path, lastExpanded);
 }
 
 Point Creature::findTarget() {
 	if (cvismap == NULL)
 		return {0,0};
 	Point tt = target;
-	for (auto it : *cvismap)
-		if (it.second.visible && it.second.creature != CreatureType::NONE && it.second.team != this->team) {
-			tt = it.first;
+	targetSighted = false;
+	for (int x = -FOV_RADIUS; x <= FOV_RADIUS; x++)
+		for (int y = -FOV_RADIUS; y <= FOV_RADIUS; y++) {
+			const Visibility & vis = (*cvismap)[Point(x, y)];
+			if (vis.visible && vis.creature != CreatureType::NONE && vis.team != this->team) {
+				tt = Point(x, y);
+				targetSighted = true;
+			}
 		}
 	return tt;
 //	return {0,0};
@@ -152,14 +213,13 @@ std::string Creature::ToString() const {
 	ts << "Type: \t";
 	try {
 		ts << foreProps.at(this->Sprite()).name << "\n";
-	} catch (std::exception e) {
+	} catch (const std::exception & e) {
 		ts << (uint8_t)this->type << " (Could not get name: " << e.what() << ")\n";
 	}
 	ts << "Position: \t" << this->position.first << ", " << this->position.second << "\n";
 	ts << "Target: \t" << this->target.first << ", " << this->target.second << "\n";
-	if (this->plan != NULL)
-		if (!this->plan->empty())
-			ts << "Next: \t" << DISPLACEMENT(this->plan->front()).first << ", " << DISPLACEMENT(this->plan->front()).second << "\n";
+	if (!this->plan.empty())
+		ts << "Next: \t" << DISPLACEMENT(this->plan.back()).first << ", " << DISPLACEMENT(this->plan.back()).second << "\n";
 	ts << "HP: \t" << this->properties.HP << "\n";
 	ts << "AC: \t" << this->properties.AC << "\n";
 	ts << "Weapon: \t d" << this->properties.attackDice << " + " << this->properties.baseAttack << "\n";
@@ -4,11 +4,76 @@
 #include "general.h"
 #include "region.h"
 #include <map>
-#include <queue>
+#include <vector>
 #include <random>
 #include "inventory.h"
+#include "fov.h"
+#include "pathfinding.h"
+#include "worldfile.h"
 
-/// @brief Class that holds a creature; use as defined by new
+/// @brief Most detours spliced into a kept plan in one turn before searching from scratch
+#define MAX_PLAN_REPAIRS 3
+
+/// @brief Random number engine that remembers its seed and how many numbers it has drawn
+///
+/// That is all it takes to rebuild it exactly, so it can be written out in a few bytes rather than its whole state
+class ReplayableEngine {
+	private:
+		/// @brief The engine
+		std::mt19937 engine;
+
+		/// @brief The seed it started from
+		std::mt19937::result_type initialSeed;
+
+		/// @brief Numbers drawn since then
+		unsigned long long drawn = 0;
+
+	public:
+		/// @brief The type of the numbers drawn
+		using result_type = std::mt19937::result_type;
+
+		/// @brief Constructor
+		///
+		/// @param seed The seed
+		/// @param draws Numbers to skip past, as if already drawn
+		ReplayableEngine(result_type seed = std::mt19937::default_seed, unsigned long long draws = 0) : engine(seed), initialSeed(seed), drawn(draws) {
+			engine.discard(draws);
+		}
+
+		/// @brief Smallest number drawn
+		static constexpr result_type min() {
+			return std::mt19937::min();
+		}
+
+		/// @brief Largest number drawn
+		static constexpr result_type max() {
+			return std::mt19937::max();
+		}
+
+		/// @brief Draw a number
+		///
+		/// @return The number
+		inline result_type operator()() {
+			drawn++;
+			return engine();
+		}
+
+		/// @brief Expose the seed
+		///
+		/// @return The seed
+		inline result_type seed() const {
+			return initialSeed;
+		}
+
+		/// @brief Expose the numbers drawn so far
+		///
+		/// @return The count
+		inline unsigned long long draws() const {
+			return drawn;
+		}
+};
+
+/// @brief Class that holds a creature; created and owned by a CreaturePool
 class Creature {
 	private:
 		/// @brief The position of the creature within the region
@@ -18,11 +83,30 @@ class Creature {
 		/// @brief The type of creature that the creature is
 		CreatureType type;
 
-		/// @brief The visibility map
-		std::map<Point, Visibility> * cvismap = NULL;
+		/// @brief The visibility grid (owned by the caller of updateFOV)
+		const VisibilityGrid * cvismap = NULL;
 		
-		/// @brief The plan of moves
-		std::queue<Direction> * plan = new std::queue<Direction>;
+		/// @brief The plan of moves, last step first (kept between turns)
+		std::vector<Direction> plan;
+
+		/// @brief The region the plan was made in, or NULL if there is no plan to keep
+		Region * planRegion = NULL;
+
+		/// @brief Where the creature should be standing when it takes the next step of the plan
+		Point planOrigin = Point(0,0);
+
+		/// @brief Where the plan ends (region coordinates)
+		Point planGoal = Point(0,0);
+
+		/// @brief Storage for detours found while repairing the plan
+		std::vector<Direction> detour;
+
+		/// @brief Try to keep last turn's plan, following a moved target and routing around blockages
+		///
+		/// @param workspace Search storage to use for detours
+		///
+		/// @return Whether plan now leads to the target; if not, a full search is needed
+		bool repairPlan(PathWorkspace & workspace);
 
 		/// @brief Find the target to move to
 		///
@@ -32,11 +116,17 @@ class Creature {
 		/// @brief The target
 		Point target = Point(0,0);
 
+		/// @brief Whether findTarget saw a hostile this turn
+		bool targetSighted = false;
+
+		/// @brief Number of nodes expanded by searches during the most recent turn
+		unsigned long lastExpanded = 0;
+
 		/// @brief The properties
 		creatureProperties properties;
 
 		/// @brief Random number generator
-		std::mt19937 gen;
+		ReplayableEngine gen;
 
 		/// @brief The d20
 		std::uniform_int_distribution<int> d20 = std::uniform_int_distribution<int>(1, 20);
@@ -47,6 +137,9 @@ class Creature {
 		/// @brief Has creature been killed?
 		bool killed = false;
 
+		/// @brief The creature's handle in its pool
+		CreatureHandle handle;
+
 		/// @brief On monster team by default, not NONE
 		Team team = Team::Monsters;
 
@@ -60,13 +153,39 @@ class Creature {
 		/// @param region Pointer to the starting region
 		/// @param type The type of creature
 		/// @param team The team the creature is on
-		Creature(Point position, Region * region, CreatureType type, Team team);
-		Creature(Point position, Region * region, CreatureType type) : Creature(position, region, type, Team::Monsters) {}
-		Creature(Point position, Region * region) : Creature(position, region, CreatureType::Rat, Team::Monsters) {}
+		/// @param seed Seed for the creature's dice
+		Creature(Point position, Region * region, CreatureType type, Team team, std::mt19937::result_type seed);
+
+		/// @brief Constructor, from a record written by save
+		///
+		/// @param in The record
+		/// @param region Pointer to the region the creature is in
+		Creature(RecordReader & in, Region * region);
+
+		/// @brief Write the creature to a record, so that the creature read back acts exactly as this one would have
+		///
+		/// The dice are kept as their seed and the number of rolls so far; a plan is kept if it was made in the creature's own region
+		///
+		/// @param out The record
+		void save(RecordWriter & out) const;
 
 		/// @brief Creature destructor
 		~Creature();
 
+		/// @brief Expose the creature's handle in its pool
+		///
+		/// @return The handle
+		inline CreatureHandle getHandle() const {
+			return handle;
+		}
+
+		/// @brief Record the creature's handle (set by the pool)
+		///
+		/// @param handle The handle
+		inline void setHandle(CreatureHandle handle) {
+			this->handle = handle;
+		}
+
 		/// @brief Get const reference to the position
 		///
 		/// @return The position
@@ -128,23 +247,33 @@ class Creature {
 
 		/// @brief Propose an action
 		///
+		/// @param workspace Search storage to use
+		/// @param field Shared distance field for the creature's region, if there is one
+		///
 		/// @return The direction
-		Direction propose_action();
+		Direction propose_action(PathWorkspace & workspace, const DistanceField * field = NULL);
 
 		/// @brief Astar for the creature
 		///
 		/// @param start The Start location
 		/// @param finish The end location
+		/// @param workspace Search storage to use
+		/// @param path Filled with the path, last step first (cleared if there is none)
 		///
-		/// @return The plan
-		std::queue<Direction> * astar(Point start, Point finish);
+		/// @return Whether a path was found
+		bool astar(Point start, Point finish, PathWorkspace & workspace, std::vector<Direction> & path);
+
+		/// @brief Expose the number of nodes expanded by searches during the most recent turn
+		///
+		/// @return The count
+		inline unsigned long lastSearchExpansions() const {
+			return lastExpanded;
+		}
 
 		/// @brief Update the field of view
 		///
-		/// @param fovmap The map (do be deleted when replaced)
-		inline void updateFOV(std::map<Point, Visibility> * fovmap) {
-			if (cvismap != NULL)
-				delete cvismap;
+		/// @param fovmap The grid (not owned; must stay valid while the creature plans)
+		inline void updateFOV(const VisibilityGrid * fovmap) {
 			cvismap = fovmap;
 		}
 
@@ -244,7 +373,7 @@ class Creature {
 		/// @brief Expose the team
 		///
 		/// @return Const reference to the team
-		inline const Team& creatureTeam() {
+		inline const Team& creatureTeam() const {
 			return team;
 		}
 
@@ -0,0 +1,64 @@
+#include "creaturepool.h"
+#include "creature.h"
+#include <new>
+#include <cstdio>
+
+CreaturePool::~CreaturePool() {
+	for (Slot & slot : slots)
+		if (slot.creature != NULL)
+			slot.creature->~Creature();
+	for (void * block : blocks)
+		::operator delete(block);
+}
+
+void * CreaturePool::storageFor(uint32_t index) {
+	return static_cast<char *>(blocks[index / CREATURE_BLOCK]) + (index % CREATURE_BLOCK) * sizeof(Creature);
+}
+
+uint32_t CreaturePool::allocate() {
+	uint32_t index;
+	if (!freeSlots.empty()) {
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	} else {
+		index = (uint32_t)slots.size();
+		if (index % CREATURE_BLOCK == 0)
+			blocks.push_back(::operator new(CREATURE_BLOCK * sizeof(Creature)));
+		slots.push_back({NULL, 1});
+	}
+	return index;
+}
+
+Creature * CreaturePool::adopt(uint32_t index, Creature * creature) {
+	Slot & slot = slots[index];
+	slot.creature = creature;
+	slot.creature->setHandle({index, slot.generation});
+	live++;
+	return slot.creature;
+}
+
+Creature * CreaturePool::create(Point position, Region * region, CreatureType type, Team team, std::mt19937::result_type seed) {
+	uint32_t index = allocate();
+	return adopt(index, new (storageFor(index)) Creature(position, region, type, team, seed));
+}
+
+Creature * CreaturePool::create(RecordReader & in, Region * region) {
+	uint32_t index = allocate();
+	return adopt(index, new (storageFor(index)) Creature(in, region));
+}
+
+void CreaturePool::release(CreatureHandle handle) {
+	Creature * creature = resolve(handle);
+	if (creature == NULL) {
+		fprintf(stderr, "Attempted to release a creature that is not in the pool\n");
+		return;
+	}
+	Slot & slot = slots[handle.index];
+	creature->~Creature();
+	slot.creature = NULL;
+	// Skip 0 so that a recycled slot never matches the null handle
+	if (++slot.generation == 0)
+		slot.generation = 1;
+	freeSlots.push_back(handle.index);
+	live--;
+}
@@ -0,0 +1,123 @@
+#ifndef CREATUREPOOL_H
+#define CREATUREPOOL_H
+
+#include "general.h"
+#include <vector>
+#include <cstddef>
+#include <random>
+#include "worldfile.h"
+
+/// @brief Number of creatures allocated together in one block of the pool
+#define CREATURE_BLOCK 64
+
+class Region;
+
+/// @brief Owns every creature; storage of released creatures is reused for new ones
+///
+/// Creatures never move once created, so pointers stay valid until release; anything kept longer should hold a CreatureHandle
+class CreaturePool {
+	private:
+		/// @brief A place for one creature
+		struct Slot {
+			/// @brief The creature, or NULL if the slot is free
+			Creature * creature;
+			/// @brief Bumped each time the slot is released
+			uint32_t generation;
+		};
+
+		/// @brief The slots; slot i lives in blocks[i / CREATURE_BLOCK]
+		std::vector<Slot> slots;
+
+		/// @brief Raw storage for CREATURE_BLOCK creatures each
+		std::vector<void *> blocks;
+
+		/// @brief Slots free for reuse
+		std::vector<uint32_t> freeSlots;
+
+		/// @brief The number of live creatures
+		std::size_t live = 0;
+
+		/// @brief Take a free slot, or add one
+		///
+		/// @return The slot
+		uint32_t allocate();
+
+		/// @brief Finish adding a creature constructed in a slot
+		///
+		/// @param index The slot
+		/// @param creature The creature
+		///
+		/// @return The creature
+		Creature * adopt(uint32_t index, Creature * creature);
+
+		/// @brief The storage for a slot
+		///
+		/// @param index The slot
+		///
+		/// @return Pointer to uninitialised storage big enough for a Creature
+		void * storageFor(uint32_t index);
+
+	public:
+		/// @brief Constructor
+		CreaturePool() {}
+
+		/// @brief Destructor; destroys any creatures still live
+		~CreaturePool();
+
+		CreaturePool(const CreaturePool&) = delete;
+		CreaturePool& operator=(const CreaturePool&) = delete;
+
+		/// @brief Create a creature in the pool
+		///
+		/// @param position Position within the region
+		/// @param region The region
+		/// @param type The type of creature
+		/// @param team The team
+		/// @param seed Seed for the creature's dice
+		///
+		/// @return The creature
+		Creature * create(Point position, Region * region, CreatureType type, Team team, std::mt19937::result_type seed);
+
+		/// @brief Create a creature in the pool from a record written by Creature::save
+		///
+		/// @param in The record
+		/// @param region The region
+		///
+		/// @return The creature
+		Creature * create(RecordReader & in, Region * region);
+
+		/// @brief Destroy a creature and recycle its slot; handles to it go stale
+		///
+		/// @param handle The creature's handle
+		void release(CreatureHandle handle);
+
+		/// @brief Look up a creature
+		///
+		/// @param handle The handle
+		///
+		/// @return The creature, or NULL if the handle is null or stale
+		inline Creature * resolve(CreatureHandle handle) const {
+			if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation)
+				return NULL;
+			return slots[handle.index].creature;
+		}
+
+		/// @brief Expose the number of live creatures
+		///
+		/// @return The count
+		inline std::size_t size() const {
+			return live;
+		}
+
+		/// @brief Call a function on every live creature
+		///
+		/// @param f The function, taking a Creature *
+		template <typename F>
+		void forEach(F f) const {
+			for (const Slot & slot : slots)
+				if (slot.creature != NULL)
+					f(slot.creature);
+		}
+};
+
+#endif
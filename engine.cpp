@@ -1,9 +1,15 @@
 #include "engine.h"
-#include <stack>
+#include "search.h"
+#include <algorithm>
 
-Engine::Engine() {
-	std::random_device rn;
-	randomengine = std::mt19937(rn());
+Engine::Engine(unsigned int threads) : Engine(threads, std::random_device()()) {}
+
+Engine::Engine(unsigned int threads, std::mt19937::result_type seed) :
+	randomengine(seed),
+	worldSeed(seed),
+	decidePool(threads != 0 ? threads : MAX(1u, std::thread::hardware_concurrency())),
+	workerViews(decidePool.size()),
+	workerSpaces(decidePool.size()) {
 	roomdist = std::uniform_int_distribution<int>(
 			MIN_ROOM_DIMENSION, 
 			MAX_ROOM_DIMENSION
@@ -12,8 +18,9 @@ Engine::Engine() {
 
 	//Temp stuff with 1 region
 	
-	Region * StartRegion = new Region(10, 10, RoomType::Spiral);
-	player = new Creature({0, 0}, StartRegion, CreatureType::Witch, Team::Player);
+	Region * StartRegion = newRegion({0, 0}, RoomType::Spiral);
+	stats.regionsGenerated++;
+	player = creaturePool.create({0, 0}, StartRegion, CreatureType::Witch, Team::Player, randomengine());
 	player->give(ItemType::Gold, 1);
 	player->give(ItemType::NONE, 17);
 	player->give(ItemType::Staff);
@@ -21,35 +28,23 @@ Engine::Engine() {
 //	Creature * rat = new Creature({5, 5}, StartRegion, CreatureType::Rat);
 //	StartRegion->putCreature(rat->getPosition(), rat);
 //	creatures.push_back(rat);
-	StartRegion->position = { 0, 0 };
 	StartRegion->putCreature( player->getPosition(), player);
-	regions.push_back(StartRegion);
 	refreshFOV();
 
 }
 
 Engine::~Engine() {
-	for (Region* region : regions) {
-		delete region;
-	}
-	for (Creature* creature : creatures) {
-		delete creature;
+	for (RegionRecord & record : regionRecords) {
+		delete record.resident;
 	}
-	delete player;
 }
 
 Background Engine::getBackground(Point point) {
 //	Point adjp = Point(point.first + currentPosition.first, point.second + currentPosition.second);
 //	Point adjp = point;
-	if (visiblelocations == NULL) {
-		fprintf(stderr, "Accessing FOV map before creation\n");
-		return Background::EMPTYNESS;
-	}
-	auto it = visiblelocations->find(point);
-	if (it == visiblelocations->end())
-		return Background::EMPTYNESS;
-	else if (it->second.visible)
-		return it->second.background;
+	const Visibility & vis = visiblelocations[point];
+	if (vis.visible)
+		return vis.background;
 	else
 		return Background::EMPTYNESS;
 }
@@ -57,43 +52,25 @@ Background Engine::getBackground(Point point) {
 Foreground Engine::getForeground(Point point) {
 //	Point adjp = Point(point.first + currentPosition.first, point.second + currentPosition.second);
 //	Point adjp = point;
-	if (visiblelocations == NULL) {
-		fprintf(stderr, "Accessing FOV map before creation\n");
-		return Foreground::NONE;
-	}
-	auto it = visiblelocations->find(point);
-	if (it == visiblelocations->end())
-		return Foreground::NONE;
-	else if (it->second.visible)
-		return it->second.foreground;
+	const Visibility & vis = visiblelocations[point];
+	if (vis.visible)
+		return vis.foreground;
 	else
 		return Foreground::NONE;
 }
 
 bool Engine::seeCreatureHere(Point point) {
-	if (visiblelocations == NULL) {
-		fprintf(stderr, "Accessing FOV map before creation\n");
-		return false;
-	}
-	auto it = visiblelocations->find(point);
-	if (it == visiblelocations->end())
-		return false;
-	else if (it->second.visible)
-		return it->second.creature != CreatureType::NONE;
+	const Visibility & vis = visiblelocations[point];
+	if (vis.visible)
+		return vis.creature != CreatureType::NONE;
 	else
 		return false;
 }
 
 double Engine::creatureHPPercentHere(Point point) {
-	if (visiblelocations == NULL) {
-		fprintf(stderr, "Accessing FOV map before creation\n");
-		return 0.0;
-	}
-	auto it = visiblelocations->find(point);
-	if (it == visiblelocations->end())
-		return 0.0;
-	else if (it->second.visible)
-		return it->second.creatureHP;
+	const Visibility & vis = visiblelocations[point];
+	if (vis.visible)
+		return vis.creatureHP;
 	else 
 		return 0.0;
 
@@ -108,6 +85,7 @@ double Engine::creatureHPPercentHere(Point point) {
 //}
 
 bool Engine::Act(Action action) {
+	auto started = std::chrono::steady_clock::now();
 	switch (action.type) {
 		case ActionType::Move:
 			if (!monsterMove(player, action.direction))
@@ -135,6 +113,8 @@ bool Engine::Act(Action action) {
 			fprintf(stderr, "Attempted to make a non-implemented action of val %d:%d\n", (int)action.type, (int)action.direction);
 			return false;
 	};
+	stats.playerSeconds += secondsSince(started);
+	stats.turns++;
 
 	doMonsterTurns();
 	return true;
@@ -179,9 +159,7 @@ BaF Engine::relBaF(Point point, const Point & relto, Region * region) {
 //}
 
 void Engine::refreshFOV() {
-	if (visiblelocations != NULL)
-		delete visiblelocations;
-	visiblelocations = FOV(player->getPosition(), player->getRegion());
+	FOV(player->getPosition(), player->getRegion(), visiblelocations);
 }
 
 void Engine::manageAltRegion(Region * curregion, const Point& position) {
@@ -189,7 +167,12 @@ void Engine::manageAltRegion(Region * curregion, const Point& position) {
 	Background cpb = curregion->getBackground(position);
 	if (cpb == Background::Door || cpb == Background::MarkedDoor) {
 		if (cpb == Background::Door) curregion->markDoor(position);
+		// A door drawn without a connection (e.g. the spiral's) can't lead anywhere, so no region is made for it
+		if (!curregion->hasConnection(position))
+			return;
 		Connection tc = curregion->connectionAt(position);
+		if (tc.to == NULL && restoreLink(curregion, position) != NULL)
+			tc = curregion->connectionAt(position);
 //		printf("manageAltRegion(), 0x%lx\n", (long int)tc.to);
 		if (tc.to != NULL) {
 			Region * alternateRegion = tc.to;
@@ -208,50 +191,52 @@ void Engine::manageAltRegion(Region * curregion, const Point& position) {
 			std::pair<Point, bool> freept;
 			Point rpoint = PAIR_SUM(curregion->position, DISPLACEMENT(tc.direction));
 			bool foundfree = false;
-			if (probdist(randomengine) < EXISTING_ROOM_PROB)
-				for (auto &&tr : regions) 
-					if (tr->position == rpoint) {
-						freept = tr->freeConnection(oppositeDirection(tc.direction));
-						if (freept.second) {
-							nr = tr;
-							foundfree = true;
-							break;
-						}
-					}
+			if (probdist(randomengine) < EXISTING_ROOM_PROB) {
+				nr = findFreeRegion(rpoint, oppositeDirection(tc.direction), freept);
+				foundfree = (nr != NULL);
+			}
 			if (!foundfree) {
-				nr = new Region(roomdist(randomengine), roomdist(randomengine), nrt);
-				nr->position = rpoint;
+				nr = newRegion(rpoint, nrt);
 				freept = nr->freeConnection(oppositeDirection(tc.direction));
 			}
 			
 			if (!freept.second) {
 //				altRegionLoaded = false;
 //				alternateRegion = NULL;
-				if (!foundfree)
-					delete nr;
+				if (!foundfree) {
+					// Never reachable, so forget it was generated
+					unindexRegion(nr);
+					discardRegion(nr);
+					regionRecords.pop_back();
+					regionCounts[rpoint]--;
+				}
 				return;
 			}
 			if (!curregion->connectTo(nr, tc.direction, position, freept.first)) {
 				fprintf(stderr, "This should not have happened: error connecting activeRegion to nr. Is this a \"real\" door?\n");
+				stats.brokenDoors++;
 //				altRegionLoaded = false;
 //				alternateRegion = NULL;
-				if (!foundfree)
-					delete nr;
+				if (!foundfree) {
+					// Never reachable, so forget it was generated
+					unindexRegion(nr);
+					discardRegion(nr);
+					regionRecords.pop_back();
+					regionCounts[rpoint]--;
+				}
 				return;
 			}
 			if (!nr->connectTo(curregion, oppositeDirection(tc.direction), freept.first, position)) {
 				fprintf(stderr, "This should not have happened: error connecting nr to activeRegion (note: corrupted activeRegion)\n");
+				stats.brokenDoors++;
 //				altRegionLoaded = false;
 //				alternateRegion = NULL;
-				if (!foundfree)
-					delete nr;
+				// activeRegion already leads to nr, so nr is kept
 				return;
 			}
 //			printf("Attached\n");
-			if (!foundfree) {
-				PopulateNewRegion(nr);
-				regions.push_back(nr);
-			}
+			if (!foundfree)
+				stats.regionsGenerated++;
 			Region * alternateRegion = nr;
 //			altDisplacement = PAIR_SUBTRACT(
 //					freept.first,
@@ -269,6 +254,291 @@ void Engine::manageAltRegion(Region * curregion, const Point& position) {
 //	printf("AR = %ld\n", (long int)alternateRegion);
 }
 
+void Engine::indexRegion(Region * region) {
+	for (uint8_t i = (uint8_t)Direction::Up; i <= (uint8_t)Direction::Down; i++)
+		if (region->freeConnection((Direction)i).second)
+			regionIndex[region->position][i].regions.push_back(region->id);
+}
+
+Region * Engine::findFreeRegion(const Point& position, Direction direction, std::pair<Point, bool>& freept) {
+	if ((uint8_t)direction > (uint8_t)Direction::Down)
+		return NULL;
+	auto it = regionIndex.find(position);
+	if (it == regionIndex.end())
+		return NULL;
+	RegionSlot & slot = it->second[(uint8_t)direction];
+	// Regions never regain free connections, so exhausted ones are skipped for good
+	while (slot.head < slot.regions.size()) {
+		// One that was dropped is brought back, just as if it had stayed
+		Region * region = recallRegion(slot.regions[slot.head]);
+		freept = region->freeConnection(direction);
+		if (freept.second)
+			return region;
+		slot.head++;
+	}
+	slot.regions.clear();
+	slot.head = 0;
+	return NULL;
+}
+
+void Engine::unindexRegion(Region * region) {
+	auto it = regionIndex.find(region->position);
+	if (it == regionIndex.end())
+		return;
+	for (RegionSlot & slot : it->second)
+		for (std::size_t i = 0; i < slot.regions.size(); i++)
+			if (slot.regions[i] == region->id) {
+				slot.regions.erase(slot.regions.begin() + i);
+				if (i < slot.head)
+					slot.head--;
+				break;
+			}
+}
+
+Region * Engine::newRegion(const Point& position, RoomType type) {
+	RegionRecord record;
+	record.position = position;
+	record.counter = regionCounts[position]++;
+	record.type = type;
+	record.resident = NULL;
+	record.lastNear = stats.turns;
+	regionRecords.push_back(record);
+	Region * region = generateRegion((unsigned int)(regionRecords.size() - 1));
+	indexRegion(region);
+	return region;
+}
+
+Region * Engine::generateRegion(unsigned int id) {
+	RegionRecord & record = regionRecords[id];
+	Region * region;
+	if (record.paged.length > 0) {
+		RecordReader in(worldFile.read(record.paged), record.paged.length);
+		region = new Region(in, &creaturePool);
+		region->id = id;
+		loadCreatures(in, region);
+		worldFile.release(record.paged);
+		record.paged = WorldExtent();
+	} else {
+		// Everything generated comes from this engine, so a region comes back the same however the game got here
+		std::seed_seq seq{(uint32_t)worldSeed, (uint32_t)record.position.first, (uint32_t)record.position.second, (uint32_t)record.counter};
+		std::mt19937 rng(seq);
+		int w = START_ROOM_DIMENSION;
+		int h = START_ROOM_DIMENSION;
+		if (record.type != RoomType::Spiral) {
+			w = roomdist(rng);
+			h = roomdist(rng);
+		}
+		region = new Region(w, h, record.type, &creaturePool, rng);
+		region->position = record.position;
+		region->id = id;
+		if (!record.creatures.empty()) {
+			// Discarded before: the creatures are as they were then, not as generated
+			RecordReader in(record.creatures.data(), record.creatures.size());
+			loadCreatures(in, region);
+			std::vector<uint8_t>().swap(record.creatures);
+		} else if (record.type != RoomType::Spiral) {
+			// The starting spiral is left empty
+			PopulateNewRegion(region, rng);
+		}
+	}
+	record.resident = region;
+
+	for (const Point & door : record.markedDoors)
+		region->markDoor(door);
+	record.markedDoors.clear();
+	for (auto it = record.severed.begin(); it != record.severed.end(); ) {
+		region->sever(it->first);
+		RegionRecord & other = regionRecords[it->second.to];
+		if (other.resident == NULL) {
+			++it;
+			continue;
+		}
+		Direction direction = region->connectionAt(it->first).direction;
+		region->connectTo(other.resident, direction, it->first, it->second.toLocation);
+		other.resident->connectTo(region, oppositeDirection(direction), it->second.toLocation, it->first);
+		// Anything standing in the doorway is in both regions
+		Creature * inDoorway = other.resident->getCreature(it->second.toLocation);
+		if (inDoorway != NULL)
+			region->putCreature(it->first, inDoorway);
+		inDoorway = region->getCreature(it->first);
+		if (inDoorway != NULL)
+			other.resident->putCreature(it->second.toLocation, inDoorway);
+		other.severed.erase(it->second.toLocation);
+		it = record.severed.erase(it);
+	}
+	region->cacheDoorCosts(pathspace);
+	return region;
+}
+
+void Engine::discardRegion(Region * region) {
+	RegionRecord & record = regionRecords[region->id];
+	for (const Point & door : region->Doors()) {
+		Connection cn = region->connectionAt(door);
+		if (cn.to == NULL)
+			continue;
+		record.severed[door] = {cn.to->id, cn.toLocation};
+		regionRecords[cn.to->id].severed[cn.toLocation] = {region->id, door};
+		cn.to->sever(cn.toLocation);
+	}
+	for (int x = -1; x <= region->Width(); x++)
+		for (int y = -1; y <= region->Height(); y++)
+			if (region->getBackground(Point(x, y)) == Background::MarkedDoor)
+				record.markedDoors.push_back(Point(x, y));
+	// A paged out region's record holds its creatures already
+	if (record.paged.length == 0) {
+		RecordWriter out;
+		saveCreatures(region, out);
+		record.creatures = out.data();
+	}
+	// Creatures standing in a doorway from a neighbour stay with the neighbour
+	region->forEachCreature([this, region](const Point&, Creature * creature) {
+		if (creature->getRegion() == region)
+			creaturePool.release(creature->getHandle());
+	});
+	parkedCreatures.erase(region);
+	record.resident = NULL;
+	delete region;
+}
+
+void Engine::saveCreatures(Region * region, RecordWriter & out) {
+	// Frozen creatures first, in the order they froze, so that they wake in the same order once read back
+	std::vector<std::pair<Creature *, unsigned long long>> own;
+	auto parked = parkedCreatures.find(region);
+	if (parked != parkedCreatures.end())
+		for (const ParkedCreature & p : parked->second) {
+			Creature * creature = creaturePool.resolve(p.creature);
+			if (creature != NULL && creature->getRegion() == region)
+				own.push_back({creature, p.time});
+		}
+	std::size_t frozen = own.size();
+	region->forEachCreature([region, &own, frozen](const Point&, Creature * creature) {
+		if (creature->getRegion() != region)
+			return;
+		for (std::size_t i = 0; i < frozen; i++)
+			if (own[i].first == creature)
+				return;
+		own.push_back({creature, 0});
+	});
+	out.put((uint32_t)own.size());
+	for (std::size_t i = 0; i < own.size(); i++) {
+		// Creatures that weren't frozen (those that never act) are frozen from now
+		out.put((i < frozen) ? own[i].second : currentTime);
+		own[i].first->save(out);
+	}
+}
+
+bool Engine::frozen(Region * region) {
+	std::size_t acting = 0;
+	region->forEachCreature([this, region, &acting](const Point&, Creature * creature) {
+		if (creature->getRegion() == region && creature != player && actionTicks(creature) != 0)
+			acting++;
+	});
+	auto parked = parkedCreatures.find(region);
+	std::size_t still = 0;
+	if (parked != parkedCreatures.end())
+		for (const ParkedCreature & p : parked->second) {
+			Creature * creature = creaturePool.resolve(p.creature);
+			if (creature != NULL && creature->getRegion() == region)
+				still++;
+		}
+	return still == acting;
+}
+
+void Engine::loadCreatures(RecordReader & in, Region * region) {
+	uint32_t count;
+	in.get(count);
+	for (uint32_t i = 0; i < count; i++) {
+		// Creatures come back frozen, catching up on what they missed when they are woken
+		unsigned long long parkedTime;
+		in.get(parkedTime);
+		Creature * creature = creaturePool.create(in, region);
+		region->putCreature(creature->getPosition(), creature);
+		parkedCreatures[region].push_back({creature->getHandle(), parkedTime});
+	}
+}
+
+bool Engine::pageOut(Region * region) {
+	RecordWriter out;
+	region->save(out);
+	saveCreatures(region, out);
+	WorldExtent extent = worldFile.write(out);
+	if (extent.length == 0)
+		return false;
+	regionRecords[region->id].paged = extent;
+	discardRegion(region);
+	return true;
+}
+
+void Engine::enforceBudget() {
+	std::size_t resident = 0;
+	std::vector<RegionRecord *> cold;
+	for (RegionRecord & record : regionRecords) {
+		if (record.resident == NULL)
+			continue;
+		resident += record.resident->footprint();
+		if (nearRegions.find(record.resident) == nearRegions.end() && record.resident != player->getRegion() && !onTravelRoute(record.resident)
+				&& frozen(record.resident))
+			cold.push_back(&record);
+	}
+	if (resident <= residentBudget)
+		return;
+	// Furthest out of reach for longest first; ties go to the oldest region, so the order is the same every run
+	std::stable_sort(cold.begin(), cold.end(), [](const RegionRecord * a, const RegionRecord * b) {
+		return a->lastNear < b->lastNear;
+	});
+	for (RegionRecord * record : cold) {
+		if (resident <= residentBudget)
+			break;
+		std::size_t bytes = record->resident->footprint();
+		if (!pageOut(record->resident))
+			break;
+		resident -= bytes;
+		stats.regionsPagedOut++;
+	}
+}
+
+void Engine::dropOutOfReach() {
+	for (RegionRecord & record : regionRecords)
+		if (record.resident != NULL && stats.turns - record.lastNear >= REGION_DISCARD_TURNS && discardable(record.resident)) {
+			discardRegion(record.resident);
+			stats.regionsDiscarded++;
+		}
+	// Whatever can't simply be regenerated is paged out, if there is still too much
+	enforceBudget();
+}
+
+bool Engine::discardable(Region * region) {
+	if (region->isModified() || region == player->getRegion() || onTravelRoute(region) || !frozen(region))
+		return false;
+	bool ownCreatures = true;
+	region->forEachCreature([region, &ownCreatures](const Point&, Creature * creature) {
+		if (creature->getRegion() != region)
+			ownCreatures = false;
+	});
+	return ownCreatures;
+}
+
+Region * Engine::restoreLink(Region * region, const Point& door) {
+	const RegionRecord & record = regionRecords[region->id];
+	auto it = record.severed.find(door);
+	if (it == record.severed.end())
+		return NULL;
+	// Regenerating reconnects every resident neighbour, including this one
+	recallRegion(it->second.to);
+	return region->connectionAt(door).to;
+}
+
+Region * Engine::recallRegion(unsigned int id) {
+	RegionRecord & record = regionRecords[id];
+	if (record.resident != NULL)
+		return record.resident;
+	if (record.paged.length > 0)
+		stats.regionsPagedIn++;
+	else
+		stats.regionsRestored++;
+	return generateRegion(id);
+}
+
 void Engine::swapRegions(Creature * creature) {
 	manageAltRegion(creature->getRegion(), creature->getPosition());
 	Connection ccon = creature->getRegion()->connectionAt(creature->getPosition());
@@ -280,115 +550,177 @@ void Engine::swapRegions(Creature * creature) {
 //	Region * playerStartRegion = creature->getRegion();
 //	playerStartRegion->putCreature(startPosition, NULL);
 //	playerStartRegion->setForeground(startPosition, underForeground);
+	creature->getRegion()->compactItems();
 	Point npos = creature->switchRegion(ccon.to, PAIR_SUBTRACT(ccon.toLocation, creature->getPosition()));
 	Region * newCreatureRegion = creature->getRegion();
 //	underForeground = newCreatureRegion->getForeground(npos);
 //	newCreatureRegion->setForeground(npos, Foreground::Witch);
-	newCreatureRegion->putCreature(npos, player);
-}
-
-std::queue<Direction> * Engine::astar(Point start, Point finish, Point relativeTo, Region * region) {
-	using movement_cost_t = double;
-	using move_t = std::pair<Point, Direction>;
-	using costandmove = std::pair<movement_cost_t, move_t>;
-	std::queue<Direction> * directions = new std::queue<Direction>;
-
-	std::priority_queue<costandmove, std::vector<costandmove>, std::greater<costandmove> > fronteir;
-	fronteir.push( 
-			{
-				0.0,
-				{
-					start,
-					Direction::Up
-				} 
-			});
-
-	std::map<Point, move_t> came_from;
-	came_from[start] = {
-		start,
-		Direction::Up
-	};
-	std::map<Point, movement_cost_t> cost_so_far;
-	cost_so_far[start] = 0.0;
-
-	bool success = false;
-	std::map<Point, Visibility> * myfov = FOV(relativeTo, region);
+	newCreatureRegion->putCreature(npos, creature);
+}
 
-	if (!bkgrProps.at((*myfov)[start].background).passible) {
-		delete myfov;
-		return directions;
-	}
-	while (!fronteir.empty()) {
-		auto current_state = fronteir.top();
-		Point current = current_state.second.first;
-		if (current == finish) {
-			success = true;
-		}
-		movement_cost_t current_cost = current_state.first;
-		fronteir.pop();
-		for (const auto & disp : displacementMap) {
-			move_t next = {
-				PAIR_SUM(disp.second, current),
-				disp.first
-			};
-			Background nb = (*myfov)[next.first].background;
-//			BaF nbaf = relBaF(next.first, relativeTo);
-			if (!bkgrProps.at(nb).passible)
-				continue;
-			movement_cost_t new_cost = ((disp.second.first != 0 && disp.second.second != 0) ? 1.41421356237 : 1) + current_cost;
-			if (cost_so_far.find(next.first) == cost_so_far.end()) {
-				fronteir.push(std::make_pair(new_cost, next));
-				came_from[next.first] = {
-					current,
-					disp.first
-				};
-				cost_so_far[next.first] = new_cost;
-			} else if (cost_so_far[next.first] > new_cost) {
-				fronteir.push(std::make_pair(new_cost, next));
-				came_from[next.first] = {
-					current,
-					disp.first
-				};
-				cost_so_far[next.first] = new_cost;
-				
-			}
+bool Engine::astar(Point start, Point finish, Point relativeTo, Region * region, PathBuffer & path) {
+	FOV(relativeTo, region, scratchView);
+	// Plain A*: searches never reach past the FOV window, where Jump Point Search is slower (see ascentbench)
+	return gridSearch(ViewGrid(scratchView), UniformCost(), start, finish, pathspace, path, searchExpansions);
+}
 
-		}
+const DistanceField * Engine::chaseField(Region * region) {
+	for (std::size_t i = 0; i < chaseFieldsBuilt; i++)
+		if (chaseFields[i].forRegion() == region)
+			return &chaseFields[i];
+	if (chaseFieldsBuilt == chaseFields.size())
+		chaseFields.push_back(DistanceField());
+	DistanceField & field = chaseFields[chaseFieldsBuilt++];
+	field.build(region, Team::Monsters, pathspace);
+	return &field;
+}
 
-	}
-	delete myfov;
+unsigned int Engine::actionTicks(const Creature * creature) {
+	double speed = creature->Properties().speed;
+	if (speed <= 0)
+		return 0;
+	return MAX(1u, (unsigned int)(TURN_TICKS / speed + 0.5));
+}
 
-	if (!success)
-		return directions;
+void Engine::scheduleTurn(Creature * creature, unsigned long long time) {
+	if (actionTicks(creature) == 0)
+		return;
+	schedule.push({time, scheduleSeq++, creature->getHandle()});
+}
 
-	std::stack<Direction> rpath;
-	Point c2 = finish;
-	while (c2 != start) {
-		move_t cfm = came_from[c2];
-		c2 = cfm.first;
-		rpath.push(cfm.second);
+void Engine::updateActivity() {
+	nearRegions.clear();
+	std::vector<Region *> frontier(1, player->getRegion());
+	std::vector<Region *> next;
+	nearRegions[player->getRegion()] = 0;
+	for (int hops = 1; hops <= NEARBY_HOPS; hops++) {
+		next.clear();
+		for (Region * region : frontier)
+			for (const Point & door : region->Doors()) {
+				Region * to = region->connectionAt(door).to;
+				if (to == NULL)
+					to = restoreLink(region, door);
+				if (to != NULL && nearRegions.find(to) == nearRegions.end()) {
+					nearRegions[to] = hops;
+					next.push_back(to);
+				}
+			}
+		frontier.swap(next);
 	}
-
-	while (!rpath.empty()) {
-		directions->push(rpath.top());
-		rpath.pop();
+	for (const auto & it : nearRegions)
+		regionRecords[it.first->id].lastNear = stats.turns;
+	if (stats.turns % REGION_DISCARD_TURNS == 0)
+		dropOutOfReach();
+	// Woken region by region in the order they were generated, not in the map's order, which depends on where regions happen to be in memory
+	waking.clear();
+	for (const auto & it : nearRegions)
+		if (parkedCreatures.find(it.first) != parkedCreatures.end())
+			waking.push_back(it.first);
+	std::sort(waking.begin(), waking.end(), [](const Region * a, const Region * b) {
+		return a->id < b->id;
+	});
+	for (Region * region : waking) {
+		auto parked = parkedCreatures.find(region);
+		for (const ParkedCreature & p : parked->second)
+			wake(p);
+		parkedCreatures.erase(parked);
 	}
+}
 
-	return directions;
+void Engine::wake(const ParkedCreature & parked) {
+	Creature * monster = creaturePool.resolve(parked.creature);
+	if (monster == NULL || !monster->isAlive())
+		return;
+	// Frozen monsters had nothing to chase, so the only thing they missed is regeneration
+	unsigned long long missed = (currentTime - parked.time) / actionTicks(monster);
+	int healing = (int)(missed * monster->Properties().regen);
+	if (healing > 0 && !monster->maxHealth())
+		monster->heal(healing);
+	scheduleTurn(monster, currentTime);
 }
 
 void Engine::doMonsterTurns() {
-	for (unsigned int i = 0; i < creatures.size(); i++) {
-		Creature * monster = creatures[i];
-		if (monster->isAlive()) {
-			monster->updateFOV(FOV(monster->getPosition(), monster->getRegion()));
-			monsterMove(monster, monster->propose_action());
+	// Fields are rebuilt each turn, as the player has moved
+	chaseFieldsBuilt = 0;
+	auto started = std::chrono::steady_clock::now();
+	updateActivity();
+	stats.activitySeconds += secondsSince(started);
+	unsigned long long playerNext = currentTime + MAX(1u, actionTicks(player));
+	while (!schedule.empty() && schedule.top().time < playerNext) {
+		// Gather every turn due at this time
+		unsigned long long now = schedule.top().time;
+		batch.clear();
+		while (!schedule.empty() && schedule.top().time == now) {
+			ScheduledTurn turn = schedule.top();
+			schedule.pop();
+			Creature * monster = creaturePool.resolve(turn.creature);
+			if (monster == NULL || !monster->isAlive())
+				continue;
+			auto near = nearRegions.find(monster->getRegion());
+			if (near == nearRegions.end()) {
+				// Far away: frozen until the player comes back
+				parkedCreatures[monster->getRegion()].push_back({turn.creature, turn.time});
+				continue;
+			}
+			batch.push_back({turn, monster, near->second <= ACTIVE_HOPS, NULL, Direction::NONE});
+		}
+
+		// Fields are built serially, as building one can grow chaseFields; the decide phase only reads them
+		started = std::chrono::steady_clock::now();
+		for (BatchTurn & bt : batch)
+			if (bt.active)
+				chaseField(bt.monster->getRegion());
+		std::size_t deciding = 0;
+		for (BatchTurn & bt : batch)
+			if (bt.active) {
+				bt.field = chaseField(bt.monster->getRegion());
+				deciding++;
+			}
+
+		// Perceive and decide: reads the world as it stands, writes only to each monster and its worker's buffers
+		auto decide = [this](std::size_t i, unsigned int worker) {
+			BatchTurn & bt = batch[i];
+			if (!bt.active)
+				return;
+			FOV(bt.monster->getPosition(), bt.monster->getRegion(), workerViews[worker]);
+			bt.monster->updateFOV(&workerViews[worker]);
+			bt.decision = bt.monster->propose_action(workerSpaces[worker], bt.field);
+		};
+		if (deciding >= PARALLEL_DECIDE_MIN)
+			decidePool.run(batch.size(), decide);
+		else
+			for (std::size_t i = 0; i < batch.size(); i++)
+				decide(i, 0);
+		stats.decideSeconds += secondsSince(started);
+
+		// Commit, in the order the turns were scheduled
+		started = std::chrono::steady_clock::now();
+		for (BatchTurn & bt : batch) {
+			Creature * monster = creaturePool.resolve(bt.turn.creature);
+			if (monster == NULL || !monster->isAlive())
+				continue;
+			double regen = monster->Properties().regen;
+			unsigned int ticks = actionTicks(monster);
+			if (bt.active) {
+				monsterMove(monster, bt.decision);
+				searchExpansions += monster->lastSearchExpansions();
+			} else {
+				// Nearby: no sight or movement, just regeneration at a slower tick
+				regen = MIN(1.0, regen * NEARBY_TICK_FACTOR);
+				ticks *= NEARBY_TICK_FACTOR;
+			}
 			if (!monster->maxHealth())
-				if (probdist(randomengine) < monster->Properties().regen)
+				if (probdist(randomengine) < regen)
 					monster->heal(1);
+			scheduleTurn(monster, bt.turn.time + ticks);
+			stats.monsterTurns++;
 		}
+		stats.commitSeconds += secondsSince(started);
 	}
+	currentTime = playerNext;
+	started = std::chrono::steady_clock::now();
 	refreshFOV();
+	stats.fovSeconds += secondsSince(started);
 	if (probdist(randomengine) < player->Properties().regen)
 		player->heal(1);
 //	printf("HP: %d\n", player->Properties().HP);
@@ -462,8 +794,10 @@ void Engine::ReportState() {
 //	for (Region * region : regions)
 //		printf("Region:\n%s\n", region->ToString(false).c_str());
 //	printf("Player:\n%s\n", player->ToString().c_str());
-	for (Creature * cr : creatures)
-		printf("Creature:\n%s\n", cr->ToString().c_str());
+	creaturePool.forEach([](Creature * cr) {
+		if (cr->creatureTeam() != Team::Player)
+			printf("Creature:\n%s\n", cr->ToString().c_str());
+	});
 }
 
 bool Engine::handleAttack(Creature * attacker, Creature * defender) {
@@ -492,21 +826,23 @@ void Engine::removeFromGame(Creature * deadded) {
 	}
 	dcregion->putCreature(deadded->getPosition(), NULL);
 	deadded->kill();
+	creaturePool.release(deadded->getHandle());
 }
 
-void Engine::PopulateNewRegion(Region * region) {
+void Engine::PopulateNewRegion(Region * region, std::mt19937 & rng) {
+	std::uniform_real_distribution<double> chance(0, 1);
 	for (int x = 0; x < region->Width(); x++)
 		for (int y = 0; y < region->Height(); y++) {
 			Background rb = region->getBackground(Point(x, y));
 			auto bp = bkgrProps.at(rb);
 			if (bp.passible && rb != Background::Door && rb != Background::MarkedDoor) {
 				if (!region->hasCreature(Point(x, y)))
-					if (probdist(randomengine) < 0.1)
+					if (chance(rng) < 0.1)
 					{
-						Creature * cr = new Creature(Point(x, y), region, CreatureType::Rat);
+						Creature * cr = creaturePool.create(Point(x, y), region, CreatureType::Rat, Team::Monsters, rng());
 						cr->give(ItemType::Gold, 1);
 						region->putCreature(Point(x, y), cr);
-						creatures.push_back(cr);
+						scheduleTurn(cr, currentTime);
 					}
 			
 			}
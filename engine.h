@@ -4,10 +4,22 @@
 #include <utility>
 #include <random>
 #include <vector>
+#include <algorithm>
+#include <map>
 #include <queue>
+#include <array>
+#include <unordered_map>
+#include <chrono>
 #include "general.h"
 #include "region.h"
 #include "creature.h"
+#include "fov.h"
+#include "pathfinding.h"
+#include "creaturepool.h"
+#include "threadpool.h"
+
+/// @brief Width and height of the starting room
+#define START_ROOM_DIMENSION 10
 
 /// @brief Minium size of a room
 #define MIN_ROOM_DIMENSION 2
@@ -17,8 +29,29 @@
 /// @brief Probability of attempting to select existing room
 #define EXISTING_ROOM_PROB 0.80
 
-/// @brief The radius of the field of view
-#define FOV_RADIUS 15
+/// @brief Time taken by an action at speed 1.0, in scheduler ticks
+#define TURN_TICKS 100
+
+/// @brief Regions at most this many connections from the player's are simulated fully
+#define ACTIVE_HOPS 1
+
+/// @brief Regions at most this many connections from the player's tick cheaply; any further are frozen
+#define NEARBY_HOPS 2
+
+/// @brief How much less often monsters in nearby regions tick
+#define NEARBY_TICK_FACTOR 4
+
+/// @brief Fewest monsters deciding at once for the decide phase to be spread over the thread pool
+#define PARALLEL_DECIDE_MIN 8
+
+/// @brief How many connections away from the player a travel destination is looked for
+#define TRAVEL_SEARCH_DEPTH 4
+
+/// @brief Turns a region must have been out of reach (beyond NEARBY_HOPS) before it may be discarded; also how often regions are swept
+#define REGION_DISCARD_TURNS 50
+
+/// @brief Default memory, in bytes, resident regions may take up before cold ones are paged out to the world file
+#define REGION_RESIDENT_BUDGET (1 << 20)
 
 /// @brief Background/foreground struct
 struct BaF {
@@ -30,8 +63,42 @@ struct BaF {
 	double HPPerHere;
 };
 
+/// @brief Counters and timings of a game, for batch runs and benchmarks
+struct EngineStats {
+	/// @brief Player actions taken (i.e. turns)
+	unsigned long turns = 0;
+	/// @brief Regions generated
+	unsigned long regionsGenerated = 0;
+	/// @brief Unmodified regions dropped from memory
+	unsigned long regionsDiscarded = 0;
+	/// @brief Discarded regions regenerated on revisit
+	unsigned long regionsRestored = 0;
+	/// @brief Modified regions written out to the world file
+	unsigned long regionsPagedOut = 0;
+	/// @brief Regions read back from the world file
+	unsigned long regionsPagedIn = 0;
+	/// @brief Doors that couldn't be linked to the region made for them, which should never happen
+	unsigned long brokenDoors = 0;
+	/// @brief Monster turns taken, including the cheap ticks of nearby monsters
+	unsigned long monsterTurns = 0;
+	/// @brief Seconds spent carrying out the player's actions
+	double playerSeconds = 0;
+	/// @brief Seconds spent working out which regions are active
+	double activitySeconds = 0;
+	/// @brief Seconds spent in the monsters' perceive and decide phase
+	double decideSeconds = 0;
+	/// @brief Seconds spent committing the monsters' moves
+	double commitSeconds = 0;
+	/// @brief Seconds spent refreshing the player's field of view
+	double fovSeconds = 0;
+};
+
 /// @brief Class for the game engine
 class Engine {
+	/// @brief The benchmarks time the FOV kernels one octant at a time
+	friend class EngineBench;
+	friend class EngineProbe;
+
 	private:
 		/// @brief Random number engine
 		std::mt19937 randomengine;
@@ -45,11 +112,236 @@ class Engine {
 		/// @brief The player creature
 		Creature* player = NULL;
 
-		/// @brief Vector of the creatures
-		std::vector<Creature*> creatures;
+		/// @brief Every creature in the game, including the player
+		CreaturePool creaturePool;
+
+		/// @brief A creature's next turn in the schedule
+		struct ScheduledTurn {
+			/// @brief When the turn is due, in ticks
+			unsigned long long time;
+			/// @brief Order the turn was scheduled in, to break ties between equal times
+			unsigned long seq;
+			/// @brief The creature; stale once it has been removed from the game
+			CreatureHandle creature;
+
+			/// @brief Order turns by time, then by when they were scheduled
+			inline bool operator>(const ScheduledTurn & other) const {
+				if (time != other.time)
+					return time > other.time;
+				return seq > other.seq;
+			}
+		};
+
+		/// @brief Monster turns not yet taken, soonest first; removed creatures are dropped when they come up
+		std::priority_queue<ScheduledTurn, std::vector<ScheduledTurn>, std::greater<ScheduledTurn>> schedule;
+
+		/// @brief The current time, in ticks
+		unsigned long long currentTime = 0;
+
+		/// @brief The number of turns scheduled so far
+		unsigned long scheduleSeq = 0;
+
+		/// @brief The time an action takes a creature, from its speed
+		///
+		/// @param creature The creature
+		///
+		/// @return The number of ticks, or 0 if the creature never acts
+		static unsigned int actionTicks(const Creature * creature);
+
+		/// @brief Schedule a creature's next turn
+		///
+		/// @param creature The creature
+		/// @param time When the turn is due
+		void scheduleTurn(Creature * creature, unsigned long long time);
+
+		/// @brief A monster frozen in a far region
+		struct ParkedCreature {
+			/// @brief The creature
+			CreatureHandle creature;
+			/// @brief When its turn came up and it was frozen
+			unsigned long long time;
+		};
+
+		/// @brief Regions within NEARBY_HOPS of the player's this turn, with their distance in connections
+		std::unordered_map<Region *, int> nearRegions;
+
+		/// @brief Monsters frozen in far regions, by region
+		std::unordered_map<Region *, std::vector<ParkedCreature>> parkedCreatures;
+
+		/// @brief Scratch list of near regions with frozen monsters, reused each turn
+		std::vector<Region *> waking;
+
+		/// @brief Rebuild nearRegions, waking any frozen monsters in regions that are now near
+		void updateActivity();
+
+		/// @brief Bring a frozen monster up to date and put it back in the schedule
+		///
+		/// @param parked The monster
+		void wake(const ParkedCreature & parked);
+
+		/// @brief Total number of nodes expanded by path searches
+		unsigned long searchExpansions = 0;
+
+		/// @brief Counters and timings
+		EngineStats stats;
+
+		/// @brief Seconds elapsed since a point in time
+		///
+		/// @param since The point in time
+		///
+		/// @return The seconds
+		static inline double secondsSince(const std::chrono::steady_clock::time_point & since) {
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+		}
+
+		/// @brief Seed every region is generated from, along with its position
+		std::mt19937::result_type worldSeed;
+
+		/// @brief A connection cut because the region on one side was discarded
+		struct RegionLink {
+			/// @brief The record of the region on the other side
+			unsigned int to;
+			/// @brief The door on the other side
+			Point toLocation;
+		};
+
+		/// @brief What a region is generated from, and the changes since that regenerating it would not restore
+		struct RegionRecord {
+			/// @brief The region position
+			Point position;
+			/// @brief How many regions were generated at this position before this one
+			unsigned int counter;
+			/// @brief The room type
+			RoomType type;
+			/// @brief The region, or NULL if discarded
+			Region * resident;
+			/// @brief The last turn the region was within NEARBY_HOPS of the player
+			unsigned long lastNear;
+			/// @brief Doors whose connection has been cut, by door
+			std::map<Point, RegionLink> severed;
+			/// @brief Doors marked before the region was discarded
+			std::vector<Point> markedDoors;
+			/// @brief The region's record in the world file, if paged out rather than discarded
+			WorldExtent paged;
+			/// @brief The region's own creatures as they were when it was discarded (see saveCreatures); empty if they come from the seed
+			std::vector<uint8_t> creatures;
+		};
+
+		/// @brief Every region ever generated, indexed by Region::id; owns the resident regions
+		std::vector<RegionRecord> regionRecords;
+
+		/// @brief The number of regions generated at each position so far
+		std::unordered_map<Point, unsigned int, PointHash> regionCounts;
+
+		/// @brief Where modified regions are paged out to
+		WorldFile worldFile;
+
+		/// @brief Memory, in bytes, resident regions may take up before cold ones are paged out
+		std::size_t residentBudget = REGION_RESIDENT_BUDGET;
+
+		/// @brief Generate a new region, recording it so that it can be regenerated
+		///
+		/// @param position The region position
+		/// @param type The room type
+		///
+		/// @return The region
+		Region * newRegion(const Point& position, RoomType type);
+
+		/// @brief Generate a region from its record (or read it back from the world file), putting back its marked doors and reconnecting it to resident neighbours
+		///
+		/// @param id The record
+		///
+		/// @return The region
+		Region * generateRegion(unsigned int id);
+
+		/// @brief Drop a region from memory, cutting its connections and keeping what is needed to regenerate it
+		///
+		/// @param region The region (deleted)
+		void discardRegion(Region * region);
+
+		/// @brief Write out the creatures a region owns, with when each was frozen
+		///
+		/// @param region The region
+		/// @param out The record to append to
+		void saveCreatures(Region * region, RecordWriter & out);
+
+		/// @brief Read back creatures written by saveCreatures into a region, frozen until it is near
+		///
+		/// @param in The record
+		/// @param region The region
+		void loadCreatures(RecordReader & in, Region * region);
+
+		/// @brief Write a region and its creatures out to the world file, then drop it from memory
+		///
+		/// @param region The region (deleted on success)
+		///
+		/// @return Success/fail
+		bool pageOut(Region * region);
+
+		/// @brief Page out the regions furthest out of reach until those left fit in residentBudget
+		void enforceBudget();
+
+		/// @brief Discard the regions that have been out of reach for REGION_DISCARD_TURNS and can be regenerated, then enforce the budget
+		void dropOutOfReach();
+
+		/// @brief Whether every creature of a region's that acts is frozen, so that it can be dropped from memory without losing a turn
+		///
+		/// @param region The region
+		///
+		/// @return True if frozen
+		bool frozen(Region * region);
+
+		/// @brief Whether a region can be discarded and later regenerated unchanged
+		///
+		/// @param region The region
+		///
+		/// @return True if its tiles and items are unmodified, it holds only its own creatures, they are frozen and it isn't in use
+		bool discardable(Region * region);
+
+		/// @brief Regenerate or page in the region behind a door whose connection was cut
+		///
+		/// @param region The region the door is on
+		/// @param door The door
+		///
+		/// @return The region behind the door, or NULL if the door was never connected
+		Region * restoreLink(Region * region, const Point& door);
+
+		/// @brief The region for a record, regenerating or paging it in if it was dropped from memory
+		///
+		/// @param id The record
+		///
+		/// @return The region
+		Region * recallRegion(unsigned int id);
+
+		/// @brief Remove a region that is being forgotten from regionIndex; regions merely dropped from memory stay in it
+		///
+		/// @param region The region
+		void unindexRegion(Region * region);
+
+		/// @brief Regions at one position that may still have a free connection in a direction
+		struct RegionSlot {
+			/// @brief The records of the regions, in the order they were created
+			std::vector<unsigned int> regions;
+			/// @brief Regions before this index are known to have no free connection left
+			std::size_t head = 0;
+		};
+
+		/// @brief Index of regions by position, with one slot for each of the four door directions
+		std::unordered_map<Point, std::array<RegionSlot, 4>, PointHash> regionIndex;
+
+		/// @brief Add a region to regionIndex under each direction it has a free connection in
+		///
+		/// @param region The region
+		void indexRegion(Region * region);
 
-		/// @brief Vector to hold all regions, to allow deletion
-		std::vector<Region*> regions;
+		/// @brief Find an existing region at a position with a free connection in a direction
+		///
+		/// @param position The region position
+		/// @param direction The direction the free connection should go in
+		/// @param freept Set to the free connection found
+		///
+		/// @return The region, or NULL if there is none
+		Region * findFreeRegion(const Point& position, Direction direction, std::pair<Point, bool>& freept);
 
 		/// @brief Manage the alternate region
 		///
@@ -62,8 +354,80 @@ class Engine {
 		/// @param creature The creature whose region is being swapped
 		void swapRegions(Creature * creature);
 
-		/// @brief Map of visible squares, accessed indirectly by the app
-		std::map<Point, Visibility>* visiblelocations = NULL;
+		/// @brief Grid of visible squares, accessed indirectly by the app
+		VisibilityGrid visiblelocations;
+
+		/// @brief Reusable FOV buffer for monster turns and searches
+		VisibilityGrid scratchView;
+
+		/// @brief Reusable search storage for monster turns and searches
+		PathWorkspace pathspace;
+
+		/// @brief Workers for the monsters' decide phase
+		ThreadPool decidePool;
+
+		/// @brief FOV buffer for each decide worker
+		std::vector<VisibilityGrid> workerViews;
+
+		/// @brief Search storage for each decide worker
+		std::vector<PathWorkspace> workerSpaces;
+
+		/// @brief A monster turn being taken in the current batch
+		struct BatchTurn {
+			/// @brief The scheduled turn
+			ScheduledTurn turn;
+			/// @brief The monster
+			Creature * monster;
+			/// @brief Whether the monster is fully simulated (otherwise it only regenerates)
+			bool active;
+			/// @brief The chase field for the monster's region, if active
+			const DistanceField * field;
+			/// @brief The move decided on
+			Direction decision;
+		};
+
+		/// @brief Monster turns due at the same time, decided together and then committed in schedule order
+		std::vector<BatchTurn> batch;
+
+		/// @brief Distance fields towards the monsters' targets; storage is reused turn to turn
+		std::vector<DistanceField> chaseFields;
+
+		/// @brief The number of chaseFields built this turn
+		std::size_t chaseFieldsBuilt = 0;
+
+		/// @brief Get this turn's distance field for a region, building it if needed
+		///
+		/// @param region The region
+		///
+		/// @return The field
+		const DistanceField * chaseField(Region * region);
+
+		/// @brief The region the player is travelling to, or NULL if not travelling
+		Region * travelRegion = NULL;
+
+		/// @brief Where in travelRegion the player is travelling to
+		Point travelGoal;
+
+		/// @brief The regions beginTravel found its way through, from travelRegion back to the player's; kept in memory until the travel ends
+		std::vector<Region *> travelRoute;
+
+		/// @brief Whether a region is on the current travel's route, and so mustn't be dropped from memory
+		///
+		/// @param region The region
+		///
+		/// @return True if on the route
+		inline bool onTravelRoute(const Region * region) const {
+			return std::find(travelRoute.begin(), travelRoute.end(), region) != travelRoute.end();
+		}
+
+		/// @brief Reusable field towards the end of the current travel leg
+		DistanceField travelField;
+
+		/// @brief Reusable field from the player, for the start of the route
+		DistanceField travelStartField;
+
+		/// @brief Reusable field towards travelGoal, for the end of the route
+		DistanceField travelGoalField;
 
 		/// @brief Converter between point and actual location
 		///
@@ -81,20 +445,39 @@ class Engine {
 		///
 		/// @param point The point (e.g. currentPosition)
 		/// @param region The region FOV is working on
+		/// @param visMap The grid to fill, relative to point
+		void FOV(Point point, Region * region, VisibilityGrid & visMap);
+
+		/// @brief Cast shadows through one octant of the FOV
 		///
-		/// @return A new std::map of visibility, relative to point
-		std::map<Point, Visibility>* FOV(Point point, Region * region);
+		/// @tparam SwapAxes Whether lines run along the x axis rather than the y axis
+		/// @tparam XTransform Sign of x in this octant
+		/// @tparam YTransform Sign of y in this octant
+		/// @param point The point the FOV is taken from
+		/// @param region The region FOV is working on
+		/// @param visMap The grid to fill, relative to point
+		template <bool SwapAxes, int XTransform, int YTransform>
+		void FOVOctant(const Point& point, Region * region, VisibilityGrid & visMap);
 		
 		/// @brief Populate a new region with creatures
 		///
 		/// @param region The region
-		void PopulateNewRegion(Region * region);
+		/// @param rng The region's random number engine
+		void PopulateNewRegion(Region * region, std::mt19937 & rng);
 
 //		bool Move(Direction direction);
 
 	public:
+		/// @brief Constructor, with a random seed
+		///
+		/// @param threads Workers for the monsters' decide phase (0 for one per core); results don't depend on it
+		Engine(unsigned int threads = 0);
+
 		/// @brief Constructor
-		Engine();
+		///
+		/// @param threads Workers for the monsters' decide phase (0 for one per core); results don't depend on it
+		/// @param seed Seed for the engine's random number engine
+		Engine(unsigned int threads, std::mt19937::result_type seed);
 		
 
 		/// @brief Destructor
@@ -149,20 +532,48 @@ class Engine {
 		/// @param finish The ending point
 		/// @param relativeTo A point to which this is relative to, e.g. currentPosition
 		/// @param region The region that the astar is working on
+		/// @param path Set to the Directions that will lead you to finish from start, last step first
 		///
-		/// @return A queue of Directions that will lead you to finish from start via the fastest route as generated by astar
-		std::queue<Direction> * astar(Point start, Point finish, Point relativeTo, Region * region);
+		/// @return Whether a path was found
+		bool astar(Point start, Point finish, Point relativeTo, Region * region, PathBuffer & path);
 
 		/// @brief Astar from the POV of the player
 		///
 		/// @param start Starting location (generally 0,0)
 		/// @param finish Finish location
+		/// @param path Set to the Directions to take, last step first
+		///
+		/// @return Whether a path was found
+		inline bool playerAstar(Point start, Point finish, PathBuffer & path) {
+			return astar(start, finish, player->getPosition(), player->getRegion(), path);
+		}
+
+		/// @brief Start travelling to a point that may lie in another region
 		///
-		/// @return Queue of directions
-		inline std::queue<Direction> * playerAstar(Point start, Point finish) {
-			player->updateFOV(FOV(player->getPosition(), player->getRegion()));
-//			return astar(start, finish, player->getPosition(), player->getRegion());
-			return player->astar(start, finish);
+		/// The point is looked for in the player's region and then through connections, in the frame
+		/// of each region it is reached through; regions dropped from memory are brought back on the way
+		///
+		/// @param finish Destination, relative to the player
+		///
+		/// @return True if a destination was found
+		bool beginTravel(Point finish);
+
+		/// @brief Route across the door graph and take the first step of the current region-local leg
+		///
+		/// @return The step, or Direction::NONE (ending the travel) if arrived or no route exists
+		Direction travelStep();
+
+		/// @brief Whether the player is travelling
+		///
+		/// @return True if travelling
+		inline bool travelling() const {
+			return travelRegion != NULL;
+		}
+
+		/// @brief Stop travelling
+		inline void cancelTravel() {
+			travelRegion = NULL;
+			travelRoute.clear();
 		}
 
 		/// @brief Expose underForeground
@@ -179,7 +590,28 @@ class Engine {
 			return player->getRegion()->itemHereString(player->getPosition());
 		}
 
-		/// @brief Do all the monster's turns
+		/// @brief Expose the counters and timings
+		///
+		/// @return The stats
+		inline const EngineStats& getStats() const {
+			return stats;
+		}
+
+		/// @brief Set the memory resident regions may take up before cold ones are paged out
+		///
+		/// @param bytes The budget, in bytes
+		inline void setResidentBudget(std::size_t bytes) {
+			residentBudget = bytes;
+		}
+
+		/// @brief Expose the total number of nodes expanded by path searches
+		///
+		/// @return The count
+		inline unsigned long totalSearchExpansions() const {
+			return searchExpansions;
+		}
+
+		/// @brief Do the turns of every monster due before the player's next action
 		void doMonsterTurns();
 
 		/// @brief Move a specific monster
@@ -221,9 +653,9 @@ class Engine {
 		/// @param defender The defender
 		bool handleAttack(Creature * attacker, Creature * defender);
 
-		/// @brief Remove a creature from the game
+		/// @brief Remove a creature from the game, returning it to the pool
 		///
-		/// @param deadded The creature to be removed
+		/// @param deadded The creature to be removed (invalid afterwards)
 		void removeFromGame(Creature * deadded);
 
 		/// @brief Get the player's properties
@@ -1,7 +1,17 @@
 #include "engine.h"
 
-std::map<Point, Visibility>* Engine::FOV(Point point, Region * region) {
-	auto visMap = new std::map<Point, Visibility>;
+const Visibility VisibilityGrid::unseen = {
+	false,
+	Background::EMPTYNESS,
+	Foreground::NONE,
+	CreatureType::NONE,
+	Team::NONE,
+	ItemType::NONE,
+	0.0
+};
+
+void Engine::FOV(Point point, Region * region, VisibilityGrid & visMap) {
+	visMap.clear();
 
 	BaF curpt = relBaF({0,0}, point, region);
 	Visibility curvs = {
@@ -13,180 +23,100 @@ std::map<Point, Visibility>* Engine::FOV(Point point, Region * region) {
 		curpt.itemHere,
 		curpt.HPPerHere
 	};
-	(*visMap)[Point(0,0)] = curvs;
+	visMap.set(Point(0,0), curvs);
 
 	// An implementation of Restrictive Precise Angle Shadowcasting, 
 	// as described at http://www.roguebasin.com/index.php?title=Restrictive_Precise_Angle_Shadowcasting&oldid=40520
 
-	using AnglePair = std::pair<double, double>;
-
-	auto fovlambda = [visMap, point, region, this](int xTransform, int yTransform) {
-		std::vector<AnglePair> * currentBlocked = new std::vector<AnglePair>;
-		std::vector<AnglePair> * nextLineBlocked = new std::vector<AnglePair>;
-
-		for (int y = 1; y < FOV_RADIUS; y++) {
-			// Copy next line into current line, and refresh next line
-			for (auto ap : *nextLineBlocked)
-				currentBlocked->push_back(ap);
-			delete nextLineBlocked;
-			nextLineBlocked = new std::vector<AnglePair>;
-
-			double arange = 1.0 / (double)(y + 1);
-			for (int x = 0; x <= y; x++) {
-				Point tp(x * xTransform, y * yTransform);
-				double startingAngle = x * arange;
-				double endingAngle = startingAngle + arange;
-				double centreAngle = startingAngle + arange / 2;
-				BaF thisCell = relBaF(tp, point, region);
-				bool tct = bkgrProps.at(thisCell.background).transparent;
-				bool centreAngleBlocked = false;
-				bool endingAngleBlocked = false;
-				bool startingAngleBlocked = false;
-				bool tcs = true;
-				for (auto ap : *currentBlocked) {
-					if (startingAngle >= ap.first && startingAngle <= ap.second)
-						startingAngleBlocked = true;
-					if (endingAngle >= ap.first && endingAngle <= ap.second)
-						endingAngleBlocked = true;
-					if (centreAngle >= ap.first && centreAngle <= ap.second)
-						centreAngleBlocked = true;
-					if (tct) {
-						if (centreAngleBlocked || (startingAngleBlocked && endingAngleBlocked)) {
-							tcs = false;
-							break;
-						}
-					} else {
-						if (centreAngleBlocked && startingAngleBlocked && endingAngleBlocked) {
-							tcs = false;
-							break;
-						}
-					}
-				}
-
-				if (tcs) {
-					Visibility thisvs = {
-						true,
-						thisCell.background,
-						thisCell.foreground,
-						thisCell.creatureHere,
-						thisCell.creatureTeam,
-						thisCell.itemHere,
-						thisCell.HPPerHere
-					};
-					(*visMap)[tp] = thisvs;
-					if (!tct)
-						nextLineBlocked->push_back(
-								AnglePair(
-									startingAngle, 
-									endingAngle));
-					
-				}
-
-
-			}
-		}
-
-		delete nextLineBlocked;
-		delete currentBlocked;
-	};
-	
-	auto fovlambda2 = [visMap, point, region, this](int xTransform, int yTransform) {
-		std::vector<AnglePair> * currentBlocked = new std::vector<AnglePair>;
-		std::vector<AnglePair> * nextLineBlocked = new std::vector<AnglePair>;
-
-		for (int x = 1; x < FOV_RADIUS; x++) {
-			// Copy next line into current line, and refresh next line
-			for (auto ap : *nextLineBlocked)
-				currentBlocked->push_back(ap);
-			delete nextLineBlocked;
-			nextLineBlocked = new std::vector<AnglePair>;
-
-			double arange = 1.0 / (double)(x + 1);
-			for (int y = 0; y <= x; y++) {
-				Point tp(x * xTransform, y * yTransform);
-				double startingAngle = y * arange;
-				double endingAngle = startingAngle + arange;
-				double centreAngle = startingAngle + arange / 2;
-				BaF thisCell = relBaF(tp, point, region);
-				bool tct = bkgrProps.at(thisCell.background).transparent;
-				bool centreAngleBlocked = false;
-				bool endingAngleBlocked = false;
-				bool startingAngleBlocked = false;
-				bool tcs = true;
-				for (auto ap : *currentBlocked) {
-					if (startingAngle >= ap.first && startingAngle <= ap.second)
-						startingAngleBlocked = true;
-					if (endingAngle >= ap.first && endingAngle <= ap.second)
-						endingAngleBlocked = true;
-					if (centreAngle >= ap.first && centreAngle <= ap.second)
-						centreAngleBlocked = true;
-					if (tct) {
-						if (centreAngleBlocked || (startingAngleBlocked && endingAngleBlocked)) {
-							tcs = false;
-							break;
-						}
-					} else {
-						if (centreAngleBlocked && startingAngleBlocked && endingAngleBlocked) {
-							tcs = false;
-							break;
-						}
-					}
-				}
-
-				if (tcs) {
-					Visibility thisvs = {
-						true,
-						thisCell.background,
-						thisCell.foreground,
-						thisCell.creatureHere,
-						thisCell.creatureTeam,
-						thisCell.itemHere,
-						thisCell.HPPerHere
-					};
-					(*visMap)[tp] = thisvs;
-					if (!tct)
-						nextLineBlocked->push_back(
-								AnglePair(
-									startingAngle, 
-									endingAngle));
-					
-				}
-
-
-			}
-		}
-
-		delete nextLineBlocked;
-		delete currentBlocked;
-	};
-
-
-
-
 	// SSW octant - x negative, y positive
-	fovlambda(-1, 1);
+	FOVOctant<false, -1, 1>(point, region, visMap);
 
 	// SSE octant - x positive, y positive
-	fovlambda(1, 1);
+	FOVOctant<false, 1, 1>(point, region, visMap);
 
 	// NNE octant - x positive, y negative
-	fovlambda(1, -1);
+	FOVOctant<false, 1, -1>(point, region, visMap);
 
 	// NNW octant - x negative, y negative
-	fovlambda(-1, -1);
+	FOVOctant<false, -1, -1>(point, region, visMap);
 	
 	// ESE octant - x positive, y positive
-	fovlambda2(1, 1);
+	FOVOctant<true, 1, 1>(point, region, visMap);
 
 	// ENE octant - x positive, y negative
-	fovlambda2(1, -1);
+	FOVOctant<true, 1, -1>(point, region, visMap);
 
 	// WSW octant - x negative, y positive
-	fovlambda2(-1, 1);
+	FOVOctant<true, -1, 1>(point, region, visMap);
 
 	// WNW octant - x negative, y negative
-	fovlambda2(-1, -1);
+	FOVOctant<true, -1, -1>(point, region, visMap);
 
+}
+
+template <bool SwapAxes, int XTransform, int YTransform>
+void Engine::FOVOctant(const Point& point, Region * region, VisibilityGrid & visMap) {
+	using AnglePair = std::pair<double, double>;
 
-	return visMap;
+	// Blocks found on one line only take effect from the next line on
+	BlockedAngles & currentBlocked = visMap.blocked;
+	std::vector<AnglePair> & nextLineBlocked = visMap.nextLineBlocked;
+	currentBlocked.clear();
+	nextLineBlocked.clear();
+
+	// line runs along the major axis (y, or x when SwapAxes), cell along the minor one
+	for (int line = 1; line < FOV_RADIUS; line++) {
+		// Merge next line into current line, and refresh next line
+		for (const auto & ap : nextLineBlocked)
+			currentBlocked.add(ap.first, ap.second);
+		nextLineBlocked.clear();
+
+		double arange = 1.0 / (double)(line + 1);
+		for (int cell = 0; cell <= line; cell++) {
+			Point tp = SwapAxes
+				? Point(line * XTransform, cell * YTransform)
+				: Point(cell * XTransform, line * YTransform);
+			double startingAngle = cell * arange;
+			double endingAngle = startingAngle + arange;
+			double centreAngle = startingAngle + arange / 2;
+			BaF thisCell = relBaF(tp, point, region);
+			bool tct = bkgrProps.at(thisCell.background).transparent;
+			bool centreAngleBlocked = currentBlocked.contains(centreAngle);
+			bool endingAngleBlocked = currentBlocked.contains(endingAngle);
+			bool startingAngleBlocked = currentBlocked.contains(startingAngle);
+			bool tcs;
+			if (tct)
+				tcs = !(centreAngleBlocked || (startingAngleBlocked && endingAngleBlocked));
+			else
+				tcs = !(centreAngleBlocked && startingAngleBlocked && endingAngleBlocked);
+
+			if (tcs) {
+				Visibility thisvs = {
+					true,
+					thisCell.background,
+					thisCell.foreground,
+					thisCell.creatureHere,
+					thisCell.creatureTeam,
+					thisCell.itemHere,
+					thisCell.HPPerHere
+				};
+				visMap.set(tp, thisvs);
+				if (!tct)
+					nextLineBlocked.push_back(
+							AnglePair(
+								startingAngle, 
+								endingAngle));
+			}
+		}
+	}
 }
+
+// Every octant is instantiated here, so that the benchmarks can run them one at a time
+template void Engine::FOVOctant<false, -1, 1>(const Point& point, Region * region, VisibilityGrid & visMap);
+template void Engine::FOVOctant<false, 1, 1>(const Point& point, Region * region, VisibilityGrid & visMap);
+template void Engine::FOVOctant<false, 1, -1>(const Point& point, Region * region, VisibilityGrid & visMap);
+template void Engine::FOVOctant<false, -1, -1>(const Point& point, Region * region, VisibilityGrid & visMap);
+template void Engine::FOVOctant<true, 1, 1>(const Point& point, Region * region, VisibilityGrid & visMap);
+template void Engine::FOVOctant<true, 1, -1>(const Point& point, Region * region, VisibilityGrid & visMap);
+template void Engine::FOVOctant<true, -1, 1>(const Point& point, Region * region, VisibilityGrid & visMap);
+template void Engine::FOVOctant<true, -1, -1>(const Point& point, Region * region, VisibilityGrid & visMap);
@@ -0,0 +1,142 @@
+#ifndef FOV_H
+#define FOV_H
+
+#include "general.h"
+#include <algorithm>
+#include <vector>
+
+/// @brief The radius of the field of view
+#define FOV_RADIUS 15
+
+/// @brief The width (and height) of the square holding a field of view
+#define FOV_DIAMETER (2 * FOV_RADIUS + 1)
+
+/// @brief Set of blocked angles for shadowcasting, kept as sorted, coalesced closed intervals
+class BlockedAngles {
+	private:
+		/// @brief A closed interval of angles
+		using AnglePair = std::pair<double, double>;
+
+		/// @brief The intervals, sorted by start; no two overlap or touch
+		std::vector<AnglePair> spans;
+
+	public:
+		/// @brief Remove all intervals (keeping the storage)
+		inline void clear() {
+			spans.clear();
+		}
+
+		/// @brief Block a closed interval, merging it with any it overlaps
+		///
+		/// @param start Start angle
+		/// @param end End angle
+		inline void add(double start, double end) {
+			auto it = std::upper_bound(spans.begin(), spans.end(), start,
+					[](double v, const AnglePair& a) { return v < a.first; });
+			if (it != spans.begin() && (it - 1)->second >= start) {
+				--it;
+				it->second = MAX(it->second, end);
+			} else
+				it = spans.insert(it, AnglePair(start, end));
+			auto next = it + 1;
+			while (next != spans.end() && next->first <= it->second) {
+				it->second = MAX(it->second, next->second);
+				++next;
+			}
+			spans.erase(it + 1, next);
+		}
+
+		/// @brief Whether an angle lies in a blocked interval
+		///
+		/// @param angle The angle
+		///
+		/// @return True if blocked
+		inline bool contains(double angle) const {
+			auto it = std::upper_bound(spans.begin(), spans.end(), angle,
+					[](double v, const AnglePair& a) { return v < a.first; });
+			if (it == spans.begin())
+				return false;
+			return (it - 1)->second >= angle;
+		}
+};
+
+/// @brief Fixed-size grid of Visibility cells, relative to the point the FOV was taken from
+///
+/// Meant to be owned by the caller and refilled by Engine::FOV, rather than allocated per call
+class VisibilityGrid {
+	private:
+		/// @brief The cells, row-major from (-FOV_RADIUS, -FOV_RADIUS)
+		Visibility cells[FOV_DIAMETER * FOV_DIAMETER];
+
+		/// @brief Angles blocked so far in the octant Engine::FOVOctant is casting; kept so its storage is reused
+		BlockedAngles blocked;
+
+		/// @brief Angles blocked on the line being cast, which only take effect from the next line
+		std::vector<std::pair<double, double>> nextLineBlocked;
+
+		friend class Engine;
+
+	public:
+		/// @brief Translate a relative point to its cell index (no bounds checking)
+		///
+		/// @param point The point
+		///
+		/// @return The index, from 0 to FOV_DIAMETER * FOV_DIAMETER - 1
+		inline static int cellIndex(const Point& point) {
+			return (point.second + FOV_RADIUS) * FOV_DIAMETER + (point.first + FOV_RADIUS);
+		}
+
+		/// @brief Translate a cell index back to its relative point
+		///
+		/// @param index The index
+		///
+		/// @return The point
+		inline static Point cellPoint(int index) {
+			return Point(index % FOV_DIAMETER - FOV_RADIUS, index / FOV_DIAMETER - FOV_RADIUS);
+		}
+
+		/// @brief The value of a cell that has not been seen
+		static const Visibility unseen;
+
+		/// @brief Constructor; starts with nothing seen
+		VisibilityGrid() {
+			clear();
+		}
+
+		/// @brief Mark every cell as unseen
+		inline void clear() {
+			std::fill(cells, cells + FOV_DIAMETER * FOV_DIAMETER, unseen);
+		}
+
+		/// @brief Whether a relative point lies within the grid
+		///
+		/// @param point The point
+		///
+		/// @return True if within FOV_RADIUS on both axes
+		inline static bool inBounds(const Point& point) {
+			return point.first >= -FOV_RADIUS && point.first <= FOV_RADIUS
+				&& point.second >= -FOV_RADIUS && point.second <= FOV_RADIUS;
+		}
+
+		/// @brief Look up a cell
+		///
+		/// @param point Point relative to the FOV origin
+		///
+		/// @return The cell, or unseen if outside the grid
+		inline const Visibility& operator[](const Point& point) const {
+			if (!inBounds(point))
+				return unseen;
+			return cells[cellIndex(point)];
+		}
+
+		/// @brief Set a cell; points outside the grid are ignored
+		///
+		/// @param point Point relative to the FOV origin
+		/// @param visibility The new value
+		inline void set(const Point& point, const Visibility& visibility) {
+			if (inBounds(point))
+				cells[cellIndex(point)] = visibility;
+		}
+};
+
+#endif
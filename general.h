@@ -5,10 +5,18 @@
 #include <utility>
 #include <map>
 #include <string>
+#include <functional>
 
 using Point = std::pair<int, int>;
 class Creature;
 
+/// @brief Hash for Point, for use in unordered containers
+struct PointHash {
+	inline std::size_t operator()(const Point& p) const {
+		return std::hash<unsigned long long>()(((unsigned long long)(unsigned int)p.first << 32) | (unsigned int)p.second);
+	}
+};
+
 /// @brief Absolute value
 ///
 /// @param A The value to take the abs of 
@@ -178,6 +186,21 @@ const std::map<Direction, Point> displacementMap = {
 /// @brief Macro to get displacement
 #define DISPLACEMENT(A) (displacementMap.at(A))
 
+/// @brief Cost of a diagonal step
+#define DIAGONAL_COST 1.41421356237
+
+/// @brief Octile distance between two points; the cheapest possible 8-way path cost
+///
+/// @param a A point
+/// @param b Another point
+///
+/// @return The distance
+inline double octileDistance(const Point& a, const Point& b) {
+	int dx = ABS(a.first - b.first);
+	int dy = ABS(a.second - b.second);
+	return (dx + dy) + (DIAGONAL_COST - 2) * MIN(dx, dy);
+}
+
 /// @brief Macro for adding pairs (of any type)
 #define PAIR_SUM(A, B) (std::make_pair(A.first + B.first, A.second + B.second))
 
@@ -310,6 +333,32 @@ enum class Team : uint8_t {
 	Monsters
 };
 
+/// @brief Generational reference to a creature held in a CreaturePool
+///
+/// Once the creature is released the slot's generation moves on, so stale handles resolve to NULL
+struct CreatureHandle {
+	/// @brief Slot in the pool
+	uint32_t index = 0;
+	/// @brief Generation of the slot when the handle was made; 0 is never live
+	uint32_t generation = 0;
+
+	/// @brief Constructor for the null handle
+	CreatureHandle() {}
+
+	/// @brief Constructor
+	///
+	/// @param index Slot in the pool
+	/// @param generation Generation of the slot
+	CreatureHandle(uint32_t index, uint32_t generation) : index(index), generation(generation) {}
+
+	/// @brief Whether the handle was ever made for a creature
+	///
+	/// @return False for the default (null) handle
+	inline bool valid() const {
+		return generation != 0;
+	}
+};
+
 /// @brief Hold the Visibility information + foreground/background of a square and other stuff to pass to displaying function
 struct Visibility {
 	/// @brief Whether the square is visible
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <random>
+
+#include "engine.h"
+
+/// @brief Translate a script key into an action, using the game's key bindings
+///
+/// @param key The key
+/// @param script The script, for reading the inventory letter after a drop
+/// @param action Set to the action
+///
+/// @return False if the key is not an action
+bool keyAction(int key, FILE * script, Action & action) {
+	switch (key) {
+		case 'h': action = {ActionType::Move, Direction::Left, '\0'}; return true;
+		case 'l': action = {ActionType::Move, Direction::Right, '\0'}; return true;
+		case 'k': action = {ActionType::Move, Direction::Up, '\0'}; return true;
+		case 'j': action = {ActionType::Move, Direction::Down, '\0'}; return true;
+		case 'y': action = {ActionType::Move, Direction::UpLeft, '\0'}; return true;
+		case 'u': action = {ActionType::Move, Direction::UpRight, '\0'}; return true;
+		case 'b': action = {ActionType::Move, Direction::DownLeft, '\0'}; return true;
+		case 'n': action = {ActionType::Move, Direction::DownRight, '\0'}; return true;
+		case '.': action = {ActionType::NONE, Direction::NONE, '\0'}; return true;
+		case 'g': action = {ActionType::Pickup, Direction::NONE, '\0'}; return true;
+		case 'd': {
+			int item = fgetc(script);
+			if (item == EOF)
+				return false;
+			action = {ActionType::Drop, Direction::NONE, (char)item};
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+/// @brief Step the engine from a script of keys, without a display
+///
+/// The script uses the game's keys (hjklyubn to move, . to wait, g to pick up, d followed by a letter to drop);
+/// a number before a key repeats it, whitespace is ignored and # comments out the rest of a line.
+/// The game's seed is printed with the results; -s replays it, and a script then plays out the same with any number of threads
+int main(int argc, char* argv[]) {
+	unsigned int threads = 1;
+	std::mt19937::result_type seed = std::random_device()();
+	const char * path = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threads = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seed = (std::mt19937::result_type)strtoul(argv[++i], NULL, 10);
+		else if (path == NULL)
+			path = argv[i];
+		else {
+			fprintf(stderr, "Usage: %s [-t threads] [-s seed] [script]\n", argv[0]);
+			return 1;
+		}
+	}
+	FILE * script = (path == NULL) ? stdin : fopen(path, "r");
+	if (script == NULL) {
+		fprintf(stderr, "Could not open script %s\n", path);
+		return 1;
+	}
+
+	Engine engine(threads, seed);
+	unsigned long taken = 0;
+	unsigned long failed = 0;
+	int repeat = 0;
+	int c;
+	while (engine.playerAlive() && (c = fgetc(script)) != EOF) {
+		if (isspace(c))
+			continue;
+		if (c == '#') {
+			while (c != EOF && c != '\n')
+				c = fgetc(script);
+			continue;
+		}
+		if (isdigit(c)) {
+			repeat = repeat * 10 + (c - '0');
+			continue;
+		}
+		Action action;
+		if (!keyAction(c, script, action)) {
+			fprintf(stderr, "Unknown key '%c' in script\n", c);
+			repeat = 0;
+			continue;
+		}
+		for (int i = 0; i < MAX(1, repeat) && engine.playerAlive(); i++) {
+			if (engine.Act(action))
+				taken++;
+			else
+				failed++;
+		}
+		repeat = 0;
+	}
+	if (script != stdin)
+		fclose(script);
+
+	Point position = engine.getCurrentPosition();
+	printf("Seed: %lu\n", (unsigned long)seed);
+	printf("Actions taken: %lu\n", taken);
+	printf("Actions failed: %lu\n", failed);
+	printf("Alive: %s\n", engine.playerAlive() ? "yes" : "no");
+	printf("HP: %d\n", engine.playerHP());
+	printf("Position: %d, %d\n", position.first, position.second);
+	printf("Gold: %u\n", engine.getPlayerInventory().total(ItemType::Gold));
+	printf("Search expansions: %lu\n", engine.totalSearchExpansions());
+	return 0;
+}
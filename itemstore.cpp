@@ -0,0 +1,88 @@
+#include "itemstore.h"
+
+int32_t ItemStore::allocChunk() {
+	int32_t index;
+	if (freeChunk != -1) {
+		index = freeChunk;
+		freeChunk = chunks[index].next;
+	} else {
+		index = (int32_t)chunks.size();
+		chunks.push_back(Chunk());
+	}
+	Chunk & chunk = chunks[index];
+	chunk.begin = 0;
+	chunk.end = 0;
+	chunk.next = -1;
+	chunk.tail = index;
+	usedChunks++;
+	return index;
+}
+
+void ItemStore::releaseChunk(int32_t index) {
+	chunks[index].next = freeChunk;
+	freeChunk = index;
+	usedChunks--;
+}
+
+void ItemStore::push(std::size_t cell, ItemType item) {
+	if (cell >= cells)
+		return;
+	if (stacks.empty())
+		stacks.assign(cells, {{ItemType::NONE}, 0, -1});
+	ItemStack & stack = stacks[cell];
+	if (stack.inlineCount == 0)
+		occupied++;
+	if (stack.overflow == -1 && stack.inlineCount < ITEMSTACK_INLINE) {
+		stack.inlineItems[stack.inlineCount++] = item;
+		return;
+	}
+	if (stack.overflow == -1)
+		stack.overflow = allocChunk();
+	int32_t tail = chunks[stack.overflow].tail;
+	if (chunks[tail].end == ITEMSTORE_CHUNK) {
+		int32_t nc = allocChunk();
+		chunks[tail].next = nc;
+		chunks[stack.overflow].tail = nc;
+		tail = nc;
+	}
+	chunks[tail].items[chunks[tail].end++] = item;
+}
+
+ItemType ItemStore::pop(std::size_t cell) {
+	if (empty(cell))
+		return ItemType::NONE;
+	ItemStack & stack = stacks[cell];
+	ItemType item = stack.inlineItems[0];
+	for (int i = 1; i < stack.inlineCount; i++)
+		stack.inlineItems[i - 1] = stack.inlineItems[i];
+	stack.inlineCount--;
+	if (stack.overflow != -1) {
+		// Pull the next item forward from the overflow arena
+		int32_t head = stack.overflow;
+		Chunk & chunk = chunks[head];
+		stack.inlineItems[stack.inlineCount++] = chunk.items[chunk.begin++];
+		if (chunk.begin == chunk.end) {
+			stack.overflow = chunk.next;
+			if (stack.overflow != -1)
+				chunks[stack.overflow].tail = chunk.tail;
+			releaseChunk(head);
+		}
+	}
+	if (stack.inlineCount == 0)
+		occupied--;
+	return item;
+}
+
+std::size_t ItemStore::compact() {
+	std::size_t released = 0;
+	if (usedChunks == 0 && chunks.capacity() > 0) {
+		released += chunks.capacity() * sizeof(Chunk);
+		std::vector<Chunk>().swap(chunks);
+		freeChunk = -1;
+	}
+	if (occupied == 0 && stacks.capacity() > 0) {
+		released += stacks.capacity() * sizeof(ItemStack);
+		std::vector<ItemStack>().swap(stacks);
+	}
+	return released;
+}
@@ -0,0 +1,151 @@
+#ifndef ITEMSTORE_H
+#define ITEMSTORE_H
+
+#include "general.h"
+#include <vector>
+#include <cstddef>
+
+/// @brief Number of items held directly in each stack before spilling into the overflow arena
+#define ITEMSTACK_INLINE 3
+
+/// @brief Number of items held in each overflow chunk
+#define ITEMSTORE_CHUNK 12
+
+/// @brief Holds the FIFO item stacks of every cell of a region, sharing one overflow arena
+class ItemStore {
+	private:
+		/// @brief A single stack; the first few items are kept inline
+		struct ItemStack {
+			/// @brief The items at the front of the stack
+			ItemType inlineItems[ITEMSTACK_INLINE];
+			/// @brief How many of inlineItems are in use
+			uint8_t inlineCount;
+			/// @brief Index of the first overflow chunk, or -1
+			int32_t overflow;
+		};
+
+		/// @brief A chunk of overflow items, linked into a list per stack
+		struct Chunk {
+			/// @brief The items
+			ItemType items[ITEMSTORE_CHUNK];
+			/// @brief Index of the first item in use
+			uint8_t begin;
+			/// @brief One past the index of the last item in use
+			uint8_t end;
+			/// @brief The next chunk in this stack (or in the free list), or -1
+			int32_t next;
+			/// @brief The last chunk in this stack; only kept up to date on the first chunk
+			int32_t tail;
+		};
+
+		/// @brief One stack per cell; left unallocated until the first item is placed
+		std::vector<ItemStack> stacks;
+
+		/// @brief The shared overflow arena
+		std::vector<Chunk> chunks;
+
+		/// @brief The number of cells
+		std::size_t cells;
+
+		/// @brief Head of the free chunk list, or -1
+		int32_t freeChunk = -1;
+
+		/// @brief The number of chunks currently in use
+		std::size_t usedChunks = 0;
+
+		/// @brief The number of non-empty stacks
+		std::size_t occupied = 0;
+
+		/// @brief Take a chunk from the free list, or grow the arena
+		///
+		/// @return The index of an empty chunk
+		int32_t allocChunk();
+
+		/// @brief Return a chunk to the free list
+		///
+		/// @param index The chunk index
+		void releaseChunk(int32_t index);
+
+	public:
+		/// @brief Constructor
+		///
+		/// @param cells The number of cells that may hold items
+		ItemStore(std::size_t cells = 0) : cells(cells) {}
+
+		/// @brief Whether a cell holds no items
+		///
+		/// @param cell The cell index
+		///
+		/// @return True if empty
+		inline bool empty(std::size_t cell) const {
+			return cell >= stacks.size() || stacks[cell].inlineCount == 0;
+		}
+
+		/// @brief Expose the number of cells
+		///
+		/// @return The count
+		inline std::size_t size() const {
+			return cells;
+		}
+
+		/// @brief The memory held by the store
+		///
+		/// @return The number of bytes
+		inline std::size_t footprint() const {
+			return stacks.capacity() * sizeof(ItemStack) + chunks.capacity() * sizeof(Chunk);
+		}
+
+		/// @brief Whether no cell holds any items
+		///
+		/// @return True if there are no items at all
+		inline bool empty() const {
+			return occupied == 0;
+		}
+
+		/// @brief View the item at the front of a cell's stack
+		///
+		/// @param cell The cell index
+		///
+		/// @return The item, or ItemType::NONE if empty
+		inline ItemType front(std::size_t cell) const {
+			if (empty(cell))
+				return ItemType::NONE;
+			return stacks[cell].inlineItems[0];
+		}
+
+		/// @brief Place an item at the back of a cell's stack
+		///
+		/// @param cell The cell index
+		/// @param item The item
+		void push(std::size_t cell, ItemType item);
+
+		/// @brief Take the item from the front of a cell's stack
+		///
+		/// @param cell The cell index
+		///
+		/// @return The item, or ItemType::NONE if empty
+		ItemType pop(std::size_t cell);
+
+		/// @brief Call a function on each item in a cell's stack, front to back
+		///
+		/// @param cell The cell index
+		/// @param f The function, taking an ItemType
+		template <typename F>
+		void forEach(std::size_t cell, F f) const {
+			if (empty(cell))
+				return;
+			const ItemStack & stack = stacks[cell];
+			for (int i = 0; i < stack.inlineCount; i++)
+				f(stack.inlineItems[i]);
+			for (int32_t c = stack.overflow; c != -1; c = chunks[c].next)
+				for (int i = chunks[c].begin; i < chunks[c].end; i++)
+					f(chunks[c].items[i]);
+		}
+
+		/// @brief Release storage that no longer holds any items
+		///
+		/// @return The number of bytes released
+		std::size_t compact();
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "pathfinding.h"
+#include "creature.h"
+#include <algorithm>
+#include <limits>
+
+PathWorkspace::PathWorkspace(std::size_t cells) :
+	stamp(cells, 0),
+	cost(cells, 0.0),
+	priority(cells, 0.0),
+	parent(cells, -1),
+	via(cells, Direction::NONE),
+	heapPos(cells, -1) {
+	heap.reserve(cells);
+}
+
+void PathWorkspace::reset() {
+	for (int cell : heap)
+		heapPos[cell] = -1;
+	heap.clear();
+	if (++generation == 0) {
+		// Stamps have wrapped around; forget them all
+		std::fill(stamp.begin(), stamp.end(), 0);
+		generation = 1;
+	}
+}
+
+void PathWorkspace::siftUp(int pos) {
+	while (pos > 0) {
+		int up = (pos - 1) / 2;
+		if (!before(pos, up))
+			break;
+		swapEntries(pos, up);
+		pos = up;
+	}
+}
+
+void PathWorkspace::siftDown(int pos) {
+	int size = (int)heap.size();
+	while (true) {
+		int best = pos;
+		int l = 2 * pos + 1;
+		int r = l + 1;
+		if (l < size && before(l, best))
+			best = l;
+		if (r < size && before(r, best))
+			best = r;
+		if (best == pos)
+			break;
+		swapEntries(pos, best);
+		pos = best;
+	}
+}
+
+void PathWorkspace::relax(int cell, double g, double f, int from, Direction direction) {
+	if (!reached(cell)) {
+		stamp[cell] = generation;
+		heapPos[cell] = -1;
+	}
+	cost[cell] = g;
+	priority[cell] = f;
+	parent[cell] = from;
+	via[cell] = direction;
+	if (heapPos[cell] == -1) {
+		heap.push_back(cell);
+		heapPos[cell] = (int)heap.size() - 1;
+	}
+	// The priority can only have dropped
+	siftUp(heapPos[cell]);
+}
+
+int PathWorkspace::pop() {
+	int top = heap[0];
+	swapEntries(0, (int)heap.size() - 1);
+	heap.pop_back();
+	heapPos[top] = -1;
+	if (!heap.empty())
+		siftDown(0);
+	return top;
+}
+
+bool DistanceField::prepare(Region * region, PathWorkspace & workspace) {
+	this->region = region;
+	width = region->Width();
+	height = region->Height();
+	std::size_t tiles = (std::size_t)(width + 2) * (height + 2);
+	dist.assign(tiles, std::numeric_limits<double>::infinity());
+	enter.assign(tiles, 0.0);
+	// The workspace only covers the FOV window; anything bigger is left unreachable
+	if (tiles > PATH_CELLS)
+		return false;
+	workspace.reset();
+	return true;
+}
+
+void DistanceField::build(Region * region, Team hunter, PathWorkspace & workspace) {
+	if (!prepare(region, workspace))
+		return;
+	region->forEachCreature([this, hunter, &workspace](const Point& location, Creature * creature) {
+		int t = tile(location);
+		if (t == -1)
+			return;
+		if (creature->creatureTeam() == hunter)
+			enter[t] = ALLY_PENALTY;
+		else if (creature->creatureTeam() != Team::NONE && creature->isAlive())
+			workspace.relax(t, 0.0, 0.0, -1, Direction::NONE);
+	});
+	flood(workspace);
+}
+
+void DistanceField::buildFrom(Region * region, const Point& source, PathWorkspace & workspace) {
+	if (!prepare(region, workspace))
+		return;
+	int t = tile(source);
+	if (t != -1)
+		workspace.relax(t, 0.0, 0.0, -1, Direction::NONE);
+	flood(workspace);
+}
+
+void DistanceField::flood(PathWorkspace & workspace) {
+	while (!workspace.empty()) {
+		int currentTile = workspace.pop();
+		double current_cost = workspace.costTo(currentTile);
+		dist[currentTile] = current_cost;
+		Point current((int)(currentTile % (width + 2)) - 1, (int)(currentTile / (width + 2)) - 1);
+		for (const auto & disp : displacementMap) {
+			if (disp.first == Direction::NONE)
+				continue;
+			Point next = PAIR_SUM(current, disp.second);
+			int nextTile = tile(next);
+			if (nextTile == -1 || !bkgrProps.at(region->getBackground(next)).passible)
+				continue;
+			// Moving from next onto current costs the step plus current's penalty
+			double new_cost = ((disp.second.first != 0 && disp.second.second != 0) ? DIAGONAL_COST : 1) + enter[currentTile] + current_cost;
+			if (!workspace.reached(nextTile) || workspace.costTo(nextTile) > new_cost)
+				workspace.relax(nextTile, new_cost, new_cost, currentTile, disp.first);
+		}
+	}
+}
+
+Direction DistanceField::downhill(const Point& from) const {
+	Direction best = Direction::NONE;
+	double bestCost = std::numeric_limits<double>::infinity();
+	for (const auto & disp : displacementMap) {
+		if (disp.first == Direction::NONE)
+			continue;
+		int t = tile(PAIR_SUM(from, disp.second));
+		if (t == -1)
+			continue;
+		double cost = ((disp.second.first != 0 && disp.second.second != 0) ? DIAGONAL_COST : 1) + enter[t] + dist[t];
+		if (cost < bestCost) {
+			bestCost = cost;
+			best = disp.first;
+		}
+	}
+	return best;
+}
@@ -0,0 +1,277 @@
+#ifndef PATHFINDING_H
+#define PATHFINDING_H
+
+#include "general.h"
+#include "fov.h"
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+/// @brief Number of cells a search can cover (the FOV window)
+#define PATH_CELLS (FOV_DIAMETER * FOV_DIAMETER)
+
+/// @brief Extra cost of stepping onto a cell held by an ally
+#define ALLY_PENALTY 2
+
+class Region;
+
+/// @brief Reusable open/closed sets and frontier for searches over the FOV window
+///
+/// All storage is allocated once; each search bumps a generation stamp instead of clearing it
+class PathWorkspace {
+	private:
+		/// @brief Generation in which each cell was last reached
+		std::vector<uint32_t> stamp;
+
+		/// @brief Cost so far of each cell
+		std::vector<double> cost;
+
+		/// @brief Frontier priority of each cell
+		std::vector<double> priority;
+
+		/// @brief Cell each cell was reached from
+		std::vector<int> parent;
+
+		/// @brief Direction taken into each cell
+		std::vector<Direction> via;
+
+		/// @brief Position of each cell in heap, or -1 if not on the frontier
+		std::vector<int> heapPos;
+
+		/// @brief Binary min-heap of cells, ordered by priority
+		std::vector<int> heap;
+
+		/// @brief The current generation
+		uint32_t generation = 0;
+
+		/// @brief Whether the heap entry at a is ordered before the one at b
+		inline bool before(int a, int b) const {
+			if (priority[heap[a]] != priority[heap[b]])
+				return priority[heap[a]] < priority[heap[b]];
+			return heap[a] < heap[b];
+		}
+
+		/// @brief Swap two heap entries, keeping heapPos up to date
+		inline void swapEntries(int a, int b) {
+			int t = heap[a];
+			heap[a] = heap[b];
+			heap[b] = t;
+			heapPos[heap[a]] = a;
+			heapPos[heap[b]] = b;
+		}
+
+		/// @brief Move a heap entry up to its place
+		///
+		/// @param pos Position in the heap
+		void siftUp(int pos);
+
+		/// @brief Move a heap entry down to its place
+		///
+		/// @param pos Position in the heap
+		void siftDown(int pos);
+
+	public:
+		/// @brief Constructor; allocates storage for every cell
+		///
+		/// @param cells The number of cells searches may cover (default the FOV window)
+		PathWorkspace(std::size_t cells = PATH_CELLS);
+
+		/// @brief Start a new search
+		void reset();
+
+		/// @brief Whether a cell has been reached in this search
+		///
+		/// @param cell The cell index
+		///
+		/// @return True if reached
+		inline bool reached(int cell) const {
+			return stamp[cell] == generation;
+		}
+
+		/// @brief Cost so far of a reached cell
+		///
+		/// @param cell The cell index
+		///
+		/// @return The cost
+		inline double costTo(int cell) const {
+			return cost[cell];
+		}
+
+		/// @brief The cell a reached cell was reached from
+		///
+		/// @param cell The cell index
+		///
+		/// @return The parent cell index, or -1 for the start
+		inline int parentOf(int cell) const {
+			return parent[cell];
+		}
+
+		/// @brief The direction taken into a reached cell
+		///
+		/// @param cell The cell index
+		///
+		/// @return The direction
+		inline Direction stepInto(int cell) const {
+			return via[cell];
+		}
+
+		/// @brief Record a (better) route to a cell and put it on the frontier
+		///
+		/// @param cell The cell index
+		/// @param g The cost so far
+		/// @param f The frontier priority
+		/// @param from The cell it was reached from
+		/// @param direction The direction taken into the cell
+		void relax(int cell, double g, double f, int from, Direction direction);
+
+		/// @brief Whether the frontier is empty
+		///
+		/// @return True if empty
+		inline bool empty() const {
+			return heap.empty();
+		}
+
+		/// @brief Take the cell with the lowest priority off the frontier
+		///
+		/// @return The cell index
+		int pop();
+};
+
+/// @brief Fixed-capacity path of steps, stored last step first so it can be consumed from the back
+class PathBuffer {
+	private:
+		/// @brief The steps; a path through the window can't visit more cells than it has
+		Direction steps[PATH_CELLS];
+
+		/// @brief The number of steps held
+		int length = 0;
+
+	public:
+		/// @brief Remove every step
+		inline void clear() {
+			length = 0;
+		}
+
+		/// @brief Whether there are no steps left
+		///
+		/// @return True if empty
+		inline bool empty() const {
+			return length == 0;
+		}
+
+		/// @brief The number of steps held
+		///
+		/// @return The count
+		inline int size() const {
+			return length;
+		}
+
+		/// @brief Append a step to be taken earlier than all the others (searches walk back from the finish, so the last step is stored first and back() is the next step)
+		///
+		/// @param step The step
+		inline void push_back(Direction step) {
+			if (length < PATH_CELLS)
+				steps[length++] = step;
+		}
+
+		/// @brief The next step to take
+		///
+		/// @return The step
+		inline Direction back() const {
+			return steps[length - 1];
+		}
+
+		/// @brief Drop the next step to take
+		inline void pop_back() {
+			length--;
+		}
+};
+
+/// @brief Distance from every tile of a region to the nearest of a set of seeds (a Dijkstra map)
+///
+/// Built once per turn per region towards the hostiles, so that every monster chasing in that region can
+/// simply step downhill; also used from single locations for door-to-door costs and travel
+class DistanceField {
+	private:
+		/// @brief The region the field was built over
+		Region * region = NULL;
+
+		/// @brief Width of the region, excluding its border
+		int width = 0;
+
+		/// @brief Height of the region, excluding its border
+		int height = 0;
+
+		/// @brief Distance to the nearest hostile, per tile (row-major, including the border)
+		std::vector<double> dist;
+
+		/// @brief Extra cost of entering each tile (ALLY_PENALTY if held by the hunting team)
+		std::vector<double> enter;
+
+		/// @brief Translate a region location to a tile index
+		///
+		/// @param location The location
+		///
+		/// @return The index, or -1 if outside the region
+		inline int tile(const Point& location) const {
+			if (location.first < -1 || location.first > width || location.second < -1 || location.second > height)
+				return -1;
+			return (location.second + 1) * (width + 2) + (location.first + 1);
+		}
+
+		/// @brief Size the field for a region and start a new search
+		///
+		/// @param region The region
+		/// @param workspace Search storage to use
+		///
+		/// @return False if the region is too big to search (everything is then left unreachable)
+		bool prepare(Region * region, PathWorkspace & workspace);
+
+		/// @brief Run Dijkstra outwards from the seeds on the workspace frontier
+		///
+		/// @param workspace Search storage holding the seeds
+		void flood(PathWorkspace & workspace);
+
+	public:
+		/// @brief Build the field
+		///
+		/// @param region The region to build over
+		/// @param hunter The team doing the chasing; creatures of any other team are targets
+		/// @param workspace Search storage to use
+		void build(Region * region, Team hunter, PathWorkspace & workspace);
+
+		/// @brief Build the field outwards from a single location, ignoring creatures
+		///
+		/// @param region The region to build over
+		/// @param source The location distances are measured to
+		/// @param workspace Search storage to use
+		void buildFrom(Region * region, const Point& source, PathWorkspace & workspace);
+
+		/// @brief Distance from a location to the nearest seed
+		///
+		/// @param location Location in the region
+		///
+		/// @return The distance, or infinity if unreachable
+		inline double distanceAt(const Point& location) const {
+			int t = tile(location);
+			if (t == -1 || dist.empty())
+				return std::numeric_limits<double>::infinity();
+			return dist[t];
+		}
+
+		/// @brief Expose the region the field was built over
+		///
+		/// @return The region
+		inline Region * forRegion() const {
+			return region;
+		}
+
+		/// @brief The cheapest step towards the nearest hostile
+		///
+		/// @param from Location in the region
+		///
+		/// @return The direction, or Direction::NONE if no hostile can be reached
+		Direction downhill(const Point& from) const;
+};
+
+#endif
@@ -1,60 +1,52 @@
 #include "region.h"
+#include "pathfinding.h"
+#include "creature.h"
 #include <random>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
-/// @brief A static random number generator, for the region
-std::mt19937 gen;
-/// @brief Whether or not the generator has been initialised
-bool initgen = false;
-/// @brief A int distribution, to be initialised as needed
-std::uniform_int_distribution<int> idist;
-/// @brief A reals distribution, to be initialised once
-std::uniform_real_distribution<double> probdist;
-
-Region::Region(int w, int h, RoomType type) {
-	if (!initgen) { // Initialise probdist - but only once
-		std::random_device rd;
-		gen = std::mt19937(rd());
-		probdist = std::uniform_real_distribution<double>(0, 1);
-		initgen = true;
-	}
+Region::Region(int w, int h, RoomType type, const CreaturePool * pool, std::mt19937 & rng) : pool(pool) {
+	std::uniform_real_distribution<double> probdist(0, 1);
+	std::uniform_int_distribution<int> idist;
 	width = w;
 	height = h;
 	this->type = type;
+	points.assign((std::size_t)(w + 2) * (h + 2), Background::EMPTYNESS);
+	items = ItemStore(points.size());
 	switch (type) {
 		case RoomType::Room:
 			for (int x = 0; x < w; x++) {
 				for (int y = 0; y < h; y++) {
 					Point tp = Point(x, y);
-					points[tp] = Background::TiledFloor;
-					if (probdist(gen) < GOLD_PROB)
+					setBackground(tp, Background::TiledFloor);
+					if (probdist(rng) < GOLD_PROB)
 						placeItem(tp, ItemType::Gold);
-					if (probdist(gen) < STAFF_PROB)
+					if (probdist(rng) < STAFF_PROB)
 						placeItem(tp, ItemType::Staff);
-					if (probdist(gen) < CHEST_PROB)
+					if (probdist(rng) < CHEST_PROB)
 						placeItem(tp, ItemType::Chest);
 				}
-				points[Point(x, -1)] = Background::StoneWall;
-				points[Point(x, h)] = Background::StoneWall;
+				setBackground(Point(x, -1), Background::StoneWall);
+				setBackground(Point(x, h), Background::StoneWall);
 			}
 			for (int y = -1; y <=h; y++) {
-				points[Point(-1, y)] = Background::StoneWall;
-				points[Point(w, y)] = Background::StoneWall;
+				setBackground(Point(-1, y), Background::StoneWall);
+				setBackground(Point(w, y), Background::StoneWall);
 			}
 //			points[Point(5, 3)] = Background::DirtWall;
 			{
 				idist = std::uniform_int_distribution<int>(4, 4 + (w + h) / 2);
-				int maxconnections = idist(gen);
+				int maxconnections = idist(rng);
 				numConnections = 0;
 				idist = std::uniform_int_distribution<int>(0, 4);
 				for (uint8_t i = 0; i < 4; i++) {
-					if (addrandomemptyconnection((Direction)(i)))
+					if (addrandomemptyconnection((Direction)(i), rng))
 						numConnections++;
 				}
 				for (uint8_t i = 4; i < maxconnections; i++) {
-					if (addrandomemptyconnection((Direction)(idist(gen))))
+					if (addrandomemptyconnection((Direction)(idist(rng)), rng))
 						numConnections++;
 				}
 //				printf("%d->%d\n", maxconnections, numConnections);
@@ -63,20 +55,20 @@ Region::Region(int w, int h, RoomType type) {
 		case RoomType::Corridor:
 			for (int x = -1; x <= w; x++)
 				for (int y = -1; y <= h; y++)
-					points[Point(x, y)] = Background::StoneWall;
+					setBackground(Point(x, y), Background::StoneWall);
 			{
 				std::uniform_int_distribution<int> ydist(0, h - 1);
-				int y = ydist(gen);
+				int y = ydist(rng);
 				for (int x = 0; x < w; x++)
-					points[Point(x, y)] = Background::TiledFloor;
+					setBackground(Point(x, y), Background::TiledFloor);
 				addrandomemptyconnection(Direction::Left, Point(-1, y));
 				addrandomemptyconnection(Direction::Right, Point(w, y));
 			} 
 			{
 				std::uniform_int_distribution<int> xdist(0, w - 1);
-				int x = xdist(gen);
+				int x = xdist(rng);
 				for (int y = 0; y < h; y++)
-					points[Point(x, y)] = Background::TiledFloor;
+					setBackground(Point(x, y), Background::TiledFloor);
 				addrandomemptyconnection(Direction::Up, Point(x, -1));
 				addrandomemptyconnection(Direction::Down, Point(x, h));
 			}
@@ -85,20 +77,20 @@ Region::Region(int w, int h, RoomType type) {
 			for (int x = 0; x < w; x++) {
 				for (int y = 0; y < h; y++) {
 					Point tp = Point(x, y);
-					points[tp] = Background::TiledFloor;
-//					if (probdist(gen) < GOLD_PROB)
+					setBackground(tp, Background::TiledFloor);
+//					if (probdist(rng) < GOLD_PROB)
 //						placeItem(tp, ItemType::Gold);
-//					if (probdist(gen) < STAFF_PROB)
+//					if (probdist(rng) < STAFF_PROB)
 //						placeItem(tp, ItemType::Staff);
-//					if (probdist(gen) < CHEST_PROB)
+//					if (probdist(rng) < CHEST_PROB)
 //						placeItem(tp, ItemType::Chest);
 				}
-				points[Point(x, -1)] = Background::StoneWall;
-				points[Point(x, h)] = Background::StoneWall;
+				setBackground(Point(x, -1), Background::StoneWall);
+				setBackground(Point(x, h), Background::StoneWall);
 			}
 			for (int y = -1; y <=h; y++) {
-				points[Point(-1, y)] = Background::StoneWall;
-				points[Point(w, y)] = Background::StoneWall;
+				setBackground(Point(-1, y), Background::StoneWall);
+				setBackground(Point(w, y), Background::StoneWall);
 			}
 			if (h >= 3 && w >= 3){ // Draw spiral
 				int layers = (MIN(w, h) - 2) / 4;
@@ -144,27 +136,27 @@ Region::Region(int w, int h, RoomType type) {
 				};
 				while (layercount < layers && currentlyDrawing.second >= 0 && currentlyDrawing.first >= 0) {
 //					printf("Printing at %d:%d\n", currentlyDrawing.first, currentlyDrawing.second);
-					points[currentlyDrawing] = Background::StoneWall;
+					setBackground(currentlyDrawing, Background::StoneWall);
 					if (!contLine(currentlyDrawing)) {
 						turnDir();
 //						printf("Turning to direction %d; layercount = %d\n", (int)drawdir, layercount);
 					}
 					currentlyDrawing = PAIR_SUM(currentlyDrawing, DISPLACEMENT(drawdir));
 				}
-				points[Point(1, 3)] = Background::Door;
+				setBackground(Point(1, 3), Background::Door);
 			}
 			{
 				addrandomemptyconnection(Direction::Up, {0, -1});
 				idist = std::uniform_int_distribution<int>(4, 4 + (w + h) / 2);
-				int maxconnections = idist(gen);
+				int maxconnections = idist(rng);
 				numConnections = 0;
 				idist = std::uniform_int_distribution<int>(0, 4);
 				for (uint8_t i = 0; i < 4 && i < maxconnections; i++) {
-					if (addrandomemptyconnection((Direction)(i)))
+					if (addrandomemptyconnection((Direction)(i), rng))
 						numConnections++;
 				}
 				for (uint8_t i = 4; i < maxconnections; i++) {
-					if (addrandomemptyconnection((Direction)(idist(gen))))
+					if (addrandomemptyconnection((Direction)(idist(rng)), rng))
 						numConnections++;
 				}
 			}
@@ -173,27 +165,113 @@ Region::Region(int w, int h, RoomType type) {
 			fprintf(stderr, "Unimplemented RoomType\n");
 			break;
 	}
-	
+	// Items placed during generation come back when the region is regenerated
+	modified = false;
+}
+
+Region::Region(RecordReader & in, const CreaturePool * pool) : pool(pool) {
+	in.get(width);
+	in.get(height);
+	in.get(type);
+	in.get(position);
+	in.get(numConnections);
+	in.get(modified);
+	points.resize((std::size_t)(width + 2) * (height + 2));
+	in.get(points.data(), points.size());
+	items = ItemStore(points.size());
+	uint32_t cell;
+	for (in.get(cell); cell != UINT32_MAX; in.get(cell)) {
+		uint32_t count;
+		in.get(count);
+		for (uint32_t i = 0; i < count; i++) {
+			ItemType item;
+			in.get(item);
+			if (cell < points.size())
+				items.push(cell, item);
+		}
+	}
+	uint32_t count;
+	in.get(count);
+	for (uint32_t i = 0; i < count; i++) {
+		Connection connection = {{0, 0}, NULL, {0, 0}, Direction::Up};
+		in.get(connection.from);
+		in.get(connection.direction);
+		connections[connection.from] = connection;
+	}
+	for (std::vector<Point> & fd : freeDoors) {
+		in.get(count);
+		fd.resize(count);
+		for (Point & door : fd)
+			in.get(door);
+	}
+}
+
+void Region::save(RecordWriter & out) const {
+	out.put(width);
+	out.put(height);
+	out.put(type);
+	out.put(position);
+	out.put(numConnections);
+	out.put(modified);
+	out.put(points.data(), points.size());
+	// Only the cells holding items, each followed by its stack, front to back
+	for (std::size_t cell = 0; cell < points.size(); cell++) {
+		if (items.empty(cell))
+			continue;
+		uint32_t count = 0;
+		items.forEach(cell, [&count](ItemType) {
+			count++;
+		});
+		out.put((uint32_t)cell);
+		out.put(count);
+		items.forEach(cell, [&out](ItemType item) {
+			out.put(item);
+		});
+	}
+	out.put((uint32_t)UINT32_MAX);
+	out.put((uint32_t)connections.size());
+	for (const auto & it : connections) {
+		out.put(it.second.from);
+		out.put(it.second.direction);
+	}
+	for (const std::vector<Point> & fd : freeDoors) {
+		out.put((uint32_t)fd.size());
+		for (const Point & door : fd)
+			out.put(door);
+	}
 }
 
-bool Region::addrandomemptyconnection(Direction direction) {
+std::size_t Region::footprint() const {
+	// Each map entry also carries a tree node's links and colour
+	const std::size_t node = 4 * sizeof(void *);
+	return sizeof(Region)
+		+ points.capacity() * sizeof(Background)
+		+ items.footprint()
+		+ creatures.size() * (sizeof(std::pair<const Point, CreatureHandle>) + node)
+		+ connections.size() * (sizeof(std::pair<const Point, Connection>) + node)
+		+ doors.capacity() * sizeof(Point)
+		+ doorCosts.capacity() * sizeof(double);
+}
+
+bool Region::addrandomemptyconnection(Direction direction, std::mt19937 & rng) {
+	std::uniform_int_distribution<int> idist;
 	Point p;
 	switch (direction) {
 		case Direction::Up:
 			idist = std::uniform_int_distribution<int>(0, width - 1);
-			p = Point(idist(gen), -1);
+			p = Point(idist(rng), -1);
 			break;
 		case Direction::Right:
 			idist = std::uniform_int_distribution<int>(0, height - 1);
-			p = Point(width, idist(gen));
+			p = Point(width, idist(rng));
 			break;
 		case Direction::Down:
 			idist = std::uniform_int_distribution<int>(0, width - 1);
-			p = Point(idist(gen), height);
+			p = Point(idist(rng), height);
 			break;
 		case Direction::Left:
 			idist = std::uniform_int_distribution<int>(0, height - 1);
-			p = Point(-1, idist(gen));
+			p = Point(-1, idist(rng));
 			break;
 		default:
 			return false;
@@ -227,41 +305,103 @@ bool Region::connectTo(Region* to, Direction direction, Point opoint, Point dpoi
 		return false;
 	it->second.to = to;
 	it->second.toLocation = dpoint;
+	std::vector<Point> & fd = freeDoors[(uint8_t)direction];
+	for (auto fit = fd.begin(); fit != fd.end(); ++fit)
+		if (*fit == opoint) {
+			fd.erase(fit);
+			break;
+		}
 	return true;
 }
 
-std::pair<Point, bool> Region::freeConnection(Direction dir) {
-	for (auto & it : connections)
-		if (it.second.direction == dir && it.second.to == NULL)
-			return {
-				it.second.from,
-				true
-			};
-	return {
-		{0,0},
-		false
-	};
+bool Region::sever(Point point) {
+	auto it = connections.find(point);
+	if (it == connections.end())
+		return false;
+	it->second.to = NULL;
+	std::vector<Point> & fd = freeDoors[(uint8_t)it->second.direction];
+	for (auto fit = fd.begin(); fit != fd.end(); ++fit)
+		if (*fit == point) {
+			fd.erase(fit);
+			break;
+		}
+	return true;
+}
+
+void Region::putCreature(Point location, Creature * creature) {
+	if (creature == NULL)
+		creatures.erase(location);
+	else
+		creatures[location] = creature->getHandle();
 }
 
 bool Region::markDoor(Point point) {
 	if (getBackground(point) != Background::Door)
 		return false;
-	points[point] = Background::MarkedDoor;
+	setBackground(point, Background::MarkedDoor);
 	return true;
 }
 
+void Region::cacheDoorCosts(PathWorkspace & workspace) {
+	doors.clear();
+	for (const auto & it : connections)
+		doors.push_back(it.first);
+	std::size_t n = doors.size();
+	doorCosts.assign(n * n, 0.0);
+	// Backgrounds never change passability after generation, so one field per door is enough
+	DistanceField field;
+	for (std::size_t i = 0; i < n; i++) {
+		field.buildFrom(this, doors[i], workspace);
+		for (std::size_t j = 0; j < n; j++)
+			doorCosts[j * n + i] = field.distanceAt(doors[j]);
+	}
+}
+
+int Region::doorIndex(const Point& location) const {
+	auto it = std::lower_bound(doors.begin(), doors.end(), location);
+	if (it == doors.end() || *it != location)
+		return -1;
+	return (int)(it - doors.begin());
+}
+
 bool Region::addrandomemptyconnection(Direction direction, Point location) {
 
-	if (points[location] == Background::Door || points[location] == Background::MarkedDoor)
+	// The door must sit on the wall matching its direction (not a corner), with floor behind it
+	bool onWall;
+	switch (direction) {
+		case Direction::Up:
+			onWall = location.second == -1 && location.first >= 0 && location.first < width;
+			break;
+		case Direction::Down:
+			onWall = location.second == height && location.first >= 0 && location.first < width;
+			break;
+		case Direction::Left:
+			onWall = location.first == -1 && location.second >= 0 && location.second < height;
+			break;
+		case Direction::Right:
+			onWall = location.first == width && location.second >= 0 && location.second < height;
+			break;
+		default:
+			onWall = false;
+			break;
+	}
+	if (!onWall)
+		return false;
+	Point inside = PAIR_SUM(location, DISPLACEMENT(oppositeDirection(direction)));
+	if (!bkgrProps.at(getBackground(inside)).passible)
+		return false;
+
+	Background lb = getBackground(location);
+	if (lb == Background::Door || lb == Background::MarkedDoor)
 		return false;
 
 	for (uint8_t i = (uint8_t)Direction::Up; i <= (uint8_t)Direction::Down; i++) {
-		Point pd = PAIR_SUM(location, DISPLACEMENT((Direction)i));
-		if (points[pd] == Background::Door || points[pd] == Background::MarkedDoor)
+		Background pb = getBackground(PAIR_SUM(location, DISPLACEMENT((Direction)i)));
+		if (pb == Background::Door || pb == Background::MarkedDoor)
 			return false;
 	}
 
-	points[location] = Background::Door;
+	setBackground(location, Background::Door);
 
 	Connection nConnection = {
 		location,
@@ -271,24 +411,22 @@ bool Region::addrandomemptyconnection(Direction direction, Point location) {
 	};
 //	connections.push_back(nConnection);
 	connections[location] = nConnection;
+	freeDoors[(uint8_t)direction].push_back(location);
 	return true;
 }
 
 std::string Region::itemHereString(Point location) const {
-	auto it = items.find(location);
-	if (it == items.end())
-		return "Here: Nothing.";
-	if (it->second.empty())
+	if (!inBounds(location) || items.empty(tileIndex(location)))
 		return "Here: Nothing.";
 	std::string str = "Here: ";
 
 	bool nfirst = false;
-	for (auto item : it->second) {
+	items.forEach(tileIndex(location), [&str, &nfirst](ItemType item) {
 		if (nfirst)
 			str += ", ";
 		nfirst = true;
 		str += foreProps.at(getItemForeground(item)).name;
-	}
+	});
 
 	str += ".";
 
@@ -307,10 +445,11 @@ std::string Region::ToString(bool showItems) const {
 	ts << "Posiiton: " << this->position.first << ", " << this->position.second << "\n";
 	ts << "Creatures:\n";
 	for (auto it : this->creatures) {
-		if (it.second != NULL) {
+		Creature * creature = pool->resolve(it.second);
+		if (creature != NULL) {
 			ts << "\tAt " << it.first.first << ", " << it.first.second << ":  ";
 			ts << std::hex;
-			ts << (long int)it.second;
+			ts << (long int)creature;
 			ts << std::dec;
 			ts << " (";
 			ts << foreProps.at(this->getForeground(it.first)).name;
@@ -319,12 +458,12 @@ std::string Region::ToString(bool showItems) const {
 	}
 	if (showItems) {
 		ts << "Items:\n";
-		for (auto it : this->items) {
-			if (!it.second.empty()) {
-				ts << "\t(" << it.first.first << ", " << it.first.second << ")  ";
-				ts << this->itemHereString(it.first) << "\n";
-			}
-		}
+		for (int x = -1; x <= width; x++)
+			for (int y = -1; y <= height; y++)
+				if (!items.empty(tileIndex(Point(x, y)))) {
+					ts << "\t(" << x << ", " << y << ")  ";
+					ts << this->itemHereString(Point(x, y)) << "\n";
+				}
 	}
 
 	return ts.str();
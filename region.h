@@ -4,9 +4,13 @@
 #include <utility>
 #include <map>
 #include <vector>
-#include <deque>
 #include <string>
+#include <cstdio>
+#include <random>
 #include "general.h"
+#include "itemstore.h"
+#include "creaturepool.h"
+#include "worldfile.h"
 
 #define GOLD_PROB 0.075
 #define STAFF_PROB 0.003
@@ -14,6 +18,7 @@
 
 
 class Region;
+class PathWorkspace;
 
 
 
@@ -42,16 +47,22 @@ enum class RoomType : uint8_t {
 
 /// @brief Class for the region (i.e. room)
 class Region {
+	/// @brief The regression checks probe door placement directly
+	friend class RegionProbe;
+
 	private:
 
-		/// @brief Creatures
-		std::map<Point, Creature *> creatures;
+		/// @brief Creatures, held by handle so that ones removed from the game can't be reached through stale entries
+		std::map<Point, CreatureHandle> creatures;
+
+		/// @brief The pool the creatures live in
+		const CreaturePool * pool;
 
-		/// @brief Each point can contain items - map the locations to a deque
-		std::map<Point, std::deque<ItemType>> items;
+		/// @brief Each point can contain items - a FIFO stack per tile, indexed like points
+		ItemStore items;
 
-		/// @brief Backgrounds
-		std::map<Point, Background> points;
+		/// @brief Backgrounds, stored row-major including the one-tile border (-1..width, -1..height)
+		std::vector<Background> points;
 
 		/// @brief Foregrounds
 //		std::map<Point, Foreground> foreground;
@@ -59,9 +70,21 @@ class Region {
 		/// @brief Connections
 		std::map<Point, Connection> connections;
 
+		/// @brief Unconnected doors in each of the four door directions, in the order they were added
+		std::vector<Point> freeDoors[4];
+
 		/// @brief The number of potential connections (i.e. doors)
 		int numConnections;
 
+		/// @brief Locations of every door, sorted, as cached by cacheDoorCosts
+		std::vector<Point> doors;
+
+		/// @brief Cost of walking between each pair of doors (doors.size() squared, row-major)
+		std::vector<double> doorCosts;
+
+		/// @brief Whether the tiles or items have changed since generation, so regenerating the region would not restore them
+		bool modified = false;
+
 		/// @brief Width of room. In rectagular room, does not include walls. Corridors may be smaller than this
 		int width;
 		
@@ -71,9 +94,10 @@ class Region {
 		/// @brief Attempt to add a (random, empty) connection
 		///
 		/// @param direction A direction, e.g. Direction::Up means on the top etc
+		/// @param rng The random number engine to draw from
 		///
 		/// @return Success/fail
-		bool addrandomemptyconnection(Direction direction);
+		bool addrandomemptyconnection(Direction direction, std::mt19937 & rng);
 
 		/// @brief Add a not-actually random connection at a specific point
 		///
@@ -86,16 +110,65 @@ class Region {
 		/// @brief The type of room this is
 		RoomType type;
 
+		/// @brief Whether a location lies within the stored grid (including the border)
+		///
+		/// @param location A location
+		///
+		/// @return True if the location has a tile
+		inline bool inBounds(const Point& location) const {
+			return location.first >= -1 && location.first <= width
+				&& location.second >= -1 && location.second <= height;
+		}
+
+		/// @brief Translate a location to its index in points (no bounds checking)
+		///
+		/// @param location A location
+		///
+		/// @return The index
+		inline std::size_t tileIndex(const Point& location) const {
+			return (std::size_t)(location.second + 1) * (width + 2) + (location.first + 1);
+		}
+
+		/// @brief Set the background at a location, ignoring locations outside the grid
+		///
+		/// @param location A location
+		/// @param background The new background
+		inline void setBackground(const Point& location, Background background) {
+			if (inBounds(location))
+				points[tileIndex(location)] = background;
+		}
+
 	public:
 		/// @brief Record of the "position" of the region
 		Point position;
+
+		/// @brief Index of the region's record in the engine, which outlives the region itself
+		unsigned int id = 0;
 		
 		/// @brief Constructor
 		///
 		/// @param w Width
 		/// @param h Height
 		/// @param type Time of room
-		Region(int w, int h, RoomType type);
+		/// @param pool The pool creatures placed in the region live in
+		/// @param rng The random number engine to generate the region from
+		Region(int w, int h, RoomType type, const CreaturePool * pool, std::mt19937 & rng);
+
+		/// @brief Constructor, from a record written by save; every connection comes back cut
+		///
+		/// @param in The record
+		/// @param pool The pool creatures placed in the region live in
+		Region(RecordReader & in, const CreaturePool * pool);
+
+		/// @brief Write the region to a record; its creatures and the targets of its connections are left to the caller
+		///
+		/// @param out The record
+		void save(RecordWriter & out) const;
+
+		/// @brief Estimate the memory held by the region
+		///
+		/// @return The number of bytes
+		std::size_t footprint() const;
 
 		/// @brief Destructor
 		~Region() {
@@ -106,13 +179,11 @@ class Region {
 		///
 		/// @param location A location
 		///
-		/// @return Background::EMPTYNESS if nothing in map, otherwise contents of map
-		inline Background getBackground(Point location) {
-			auto it = points.find(location);
-			if (it == points.end())
+		/// @return Background::EMPTYNESS if outside the grid, otherwise contents of the grid
+		inline Background getBackground(Point location) const {
+			if (!inBounds(location))
 				return Background::EMPTYNESS;
-			else 
-				return it->second;
+			return points[tileIndex(location)];
 		}
 
 		/// @brief Expose foreground
@@ -127,16 +198,11 @@ class Region {
 //			else
 //				return it->second;
 			auto it = creatures.find(location);
-			if (it != creatures.end() && it->second != NULL)
-				return getCreaturePointerForeground(it->second);
+			Creature * creature = (it != creatures.end()) ? pool->resolve(it->second) : NULL;
+			if (creature != NULL)
+				return getCreaturePointerForeground(creature);
 			else {
-				auto it = items.find(location);
-				if (it == items.end())
-					return Foreground::NONE;
-				else if (it->second.empty())
-					return Foreground::NONE;
-				else
-					return getItemForeground(it->second[0]);
+				return getItemForeground(topItem(location));
 			}
 		}
 
@@ -159,7 +225,12 @@ class Region {
 		/// @param location The location
 		/// @param item The item
 		inline void placeItem(Point location, ItemType item) {
-			items[location].push_back(item);
+			if (!inBounds(location)) {
+				fprintf(stderr, "Attempted to place an item outside of the region\n");
+				return;
+			}
+			items.push(tileIndex(location), item);
+			modified = true;
 		}
 
 		/// @brief Take an item from the top of the queue at a particular location
@@ -168,13 +239,12 @@ class Region {
 		///
 		/// @return The item
 		inline ItemType takeItem(Point location) {
-			if (items[location].empty())
+			if (!inBounds(location))
 				return ItemType::NONE;
-			else {
-				ItemType item = items[location][0];
-				items[location].pop_front();
-				return item;
-			}
+			ItemType item = items.pop(tileIndex(location));
+			if (item != ItemType::NONE)
+				modified = true;
+			return item;
 		}
 
 		/// @brief View the item at the top of the queue at a particular location
@@ -182,13 +252,17 @@ class Region {
 		/// @param location The location
 		///
 		/// @return The item
-		inline ItemType topItem(Point location) {
-			if (items[location].empty())
+		inline ItemType topItem(Point location) const {
+			if (!inBounds(location))
 				return ItemType::NONE;
-			else {
-				ItemType item = items[location][0];
-				return item;
-			}
+			return items.front(tileIndex(location));
+		}
+
+		/// @brief Release item storage that no longer holds any items
+		///
+		/// @return The number of bytes released
+		inline std::size_t compactItems() {
+			return items.compact();
 		}
 		
 		/// @brief Get the creature at a location
@@ -199,7 +273,7 @@ class Region {
 		inline Creature * getCreature(Point location) {
 			auto it = creatures.find(location);
 			if (it != creatures.end())
-				return it->second;
+				return pool->resolve(it->second);
 			else
 				return NULL;
 		}
@@ -213,13 +287,23 @@ class Region {
 			return (getCreature(location) != NULL);
 		}
 
+		/// @brief Call a function on every creature in the region
+		///
+		/// @param f The function, taking the location and the creature
+		template <typename F>
+		void forEachCreature(F f) const {
+			for (const auto & it : creatures) {
+				Creature * creature = pool->resolve(it.second);
+				if (creature != NULL)
+					f(it.first, creature);
+			}
+		}
+
 		/// @brief Place (overwrite) the creature at a location
 		///
 		/// @param location The location
-		/// @param creature The creature
-		inline void putCreature(Point location, Creature * creature) {
-			creatures[location] = creature;
-		}
+		/// @param creature The creature, or NULL to clear the location
+		void putCreature(Point location, Creature * creature);
 
 		/// @brief Connect this region to another (need to run on other, if mutual)
 		///
@@ -230,6 +314,22 @@ class Region {
 		/// @return Success/fail
 		bool connectTo(Region* to, Direction direction, Point opoint, Point dpoint);
 
+		/// @brief Cut the connection at a door, leaving the door taken so that nothing else is connected there
+		///
+		/// @param point The door
+		///
+		/// @return Success/fail
+		bool sever(Point point);
+
+		/// @brief Whether a point has a connection, linked or not; doors drawn without one lead nowhere
+		///
+		/// @param point The coords
+		///
+		/// @return True if it has one
+		inline bool hasConnection(Point point) const {
+			return connections.find(point) != connections.end();
+		}
+
 		/// @brief Get the connection at a point (i.e. translate door coords to the connection)
 		///
 		/// @param point The coords
@@ -253,7 +353,46 @@ class Region {
 		/// @param dir The direction it's going
 		///
 		/// @return Pair of the point, and true/false is free
-		std::pair<Point, bool> freeConnection(Direction dir);
+		inline std::pair<Point, bool> freeConnection(Direction dir) const {
+			if ((uint8_t)dir > (uint8_t)Direction::Down || freeDoors[(uint8_t)dir].empty())
+				return {
+					{0,0},
+					false
+				};
+			return {
+				freeDoors[(uint8_t)dir].front(),
+				true
+			};
+		}
+
+		/// @brief Work out and cache the cost of walking between every pair of doors
+		///
+		/// @param workspace Search storage to use
+		void cacheDoorCosts(PathWorkspace & workspace);
+
+		/// @brief Expose the cached door locations
+		///
+		/// @return The doors, sorted
+		inline const std::vector<Point>& Doors() const {
+			return doors;
+		}
+
+		/// @brief Find the index of a door in Doors()
+		///
+		/// @param location The location
+		///
+		/// @return The index, or -1 if there is no door there
+		int doorIndex(const Point& location) const;
+
+		/// @brief Cached cost of walking between two doors
+		///
+		/// @param from Index of the first door
+		/// @param to Index of the second door
+		///
+		/// @return The cost, or infinity if one cannot be reached from the other
+		inline double doorCost(int from, int to) const {
+			return doorCosts[from * doors.size() + to];
+		}
 
 		/// @brief Mark a door
 		///
@@ -269,6 +408,15 @@ class Region {
 			return type;
 		}
 
+		/// @brief Whether the tiles or items have changed in a way regenerating the region would not restore
+		///
+		/// Creatures moving, being hurt or dying don't count; they are kept aside when the region is discarded
+		///
+		/// @return True if modified
+		inline bool isModified() const {
+			return modified;
+		}
+
 		/// @brief Get a "here" string for all the items at a location
 		///
 		/// @param location The location
@@ -0,0 +1,284 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "general.h"
+#include "fov.h"
+#include "pathfinding.h"
+
+/// @brief Grid access policy: a search over a field of view, relative to the point it was taken from
+class ViewGrid {
+	private:
+		/// @brief The field of view
+		const VisibilityGrid & view;
+
+	public:
+		/// @brief Constructor
+		///
+		/// @param view The field of view (not owned)
+		ViewGrid(const VisibilityGrid & view) : view(view) {}
+
+		/// @brief Whether a point can be searched at all
+		///
+		/// @param point The point
+		///
+		/// @return True if within the window
+		inline bool contains(const Point& point) const {
+			return VisibilityGrid::inBounds(point);
+		}
+
+		/// @brief Whether a point can be stepped onto
+		///
+		/// @param point The point
+		///
+		/// @return True if within the window and passable
+		inline bool passable(const Point& point) const {
+			return contains(point) && bkgrProps.at(view[point].background).passible;
+		}
+
+		/// @brief What is seen at a point
+		///
+		/// @param point The point
+		///
+		/// @return The cell
+		inline const Visibility& at(const Point& point) const {
+			return view[point];
+		}
+
+		/// @brief Translate a point to its index in the search workspace
+		///
+		/// @param point The point
+		///
+		/// @return The index
+		inline int index(const Point& point) const {
+			return VisibilityGrid::cellIndex(point);
+		}
+
+		/// @brief Translate an index in the search workspace back to its point
+		///
+		/// @param index The index
+		///
+		/// @return The point
+		inline Point point(int index) const {
+			return VisibilityGrid::cellPoint(index);
+		}
+};
+
+/// @brief Cost policy for the player's click-to-move: every step costs its length, as Jump Point Search assumes
+struct UniformCost {
+	/// @brief Extra cost of stepping onto a cell
+	///
+	/// @return Always 0
+	inline double enter(const Visibility&) const {
+		return 0;
+	}
+};
+
+/// @brief Cost policy for monster chases: cells held by the searcher's own team cost extra, so allies are passed rather than queued behind
+struct TeamCost {
+	/// @brief The team of the searching creature
+	Team team;
+
+	/// @brief Extra cost of stepping onto a cell
+	///
+	/// @param cell What is seen on the cell
+	///
+	/// @return ALLY_PENALTY if an ally is there, otherwise 0
+	inline double enter(const Visibility& cell) const {
+		return (cell.team == team) ? ALLY_PENALTY : 0;
+	}
+};
+
+/// @brief A* with the octile heuristic, stopping as soon as the finish is taken off the frontier
+///
+/// @tparam Grid Grid access policy (e.g. ViewGrid)
+/// @tparam Cost Cost policy (e.g. UniformCost, TeamCost)
+/// @tparam Path Container taking steps through push_back (e.g. PathBuffer, std::vector<Direction>)
+/// @param grid The grid
+/// @param cost The cost policy
+/// @param start The starting point
+/// @param finish The ending point
+/// @param workspace Search storage to use
+/// @param path Set to the path, last step first; cleared if none is found
+/// @param expanded Incremented by the number of nodes expanded
+///
+/// @return Whether a path was found
+template <typename Grid, typename Cost, typename Path>
+bool gridSearch(const Grid & grid, const Cost & cost, const Point& start, const Point& finish, PathWorkspace & workspace, Path & path, unsigned long & expanded) {
+	path.clear();
+	if (!grid.passable(start) || !grid.contains(finish))
+		return false;
+
+	workspace.reset();
+	int startCell = grid.index(start);
+	int finishCell = grid.index(finish);
+	workspace.relax(startCell, 0.0, octileDistance(start, finish), -1, Direction::Up);
+
+	bool success = false;
+	while (!workspace.empty()) {
+		int currentCell = workspace.pop();
+		if (currentCell == finishCell) {
+			success = true;
+			break;
+		}
+		expanded++;
+		Point current = grid.point(currentCell);
+		double current_cost = workspace.costTo(currentCell);
+		for (const auto & disp : displacementMap) {
+			if (disp.first == Direction::NONE)
+				continue;
+			Point next = PAIR_SUM(disp.second, current);
+			if (!grid.passable(next))
+				continue;
+			double new_cost = ((disp.second.first != 0 && disp.second.second != 0) ? DIAGONAL_COST : 1) + cost.enter(grid.at(next)) + current_cost;
+			int nextCell = grid.index(next);
+			if (!workspace.reached(nextCell) || workspace.costTo(nextCell) > new_cost)
+				workspace.relax(nextCell, new_cost, new_cost + octileDistance(next, finish), currentCell, disp.first);
+		}
+	}
+	if (!success)
+		return false;
+
+	// Walk back from the finish; the path ends up last step first
+	for (int c = finishCell; c != startCell; c = workspace.parentOf(c))
+		path.push_back(workspace.stepInto(c));
+	return true;
+}
+
+/// @brief Follow a jump from a point in one direction until it reaches a jump point
+///
+/// A jump point is the finish, a point with a forced neighbour, or (for diagonal jumps) a point from which a straight jump finds one
+///
+/// @tparam Grid Grid access policy
+/// @param grid The grid
+/// @param from The point jumped from
+/// @param step The displacement of the direction being jumped in
+/// @param finish The ending point
+/// @param found Set to the jump point
+///
+/// @return False if the jump runs into something impassable first
+template <typename Grid>
+bool jump(const Grid & grid, Point from, const Point& step, const Point& finish, Point & found) {
+	int dx = step.first;
+	int dy = step.second;
+	Point current = from;
+	while (true) {
+		current = PAIR_SUM(current, step);
+		int x = current.first;
+		int y = current.second;
+		if (!grid.passable(current))
+			return false;
+		bool jumpPoint = (current == finish);
+		if (dx != 0 && dy != 0) {
+			Point unused;
+			jumpPoint = jumpPoint
+				|| (!grid.passable(Point(x - dx, y)) && grid.passable(Point(x - dx, y + dy)))
+				|| (!grid.passable(Point(x, y - dy)) && grid.passable(Point(x + dx, y - dy)))
+				|| jump(grid, current, Point(dx, 0), finish, unused)
+				|| jump(grid, current, Point(0, dy), finish, unused);
+		} else if (dx != 0) {
+			jumpPoint = jumpPoint
+				|| (!grid.passable(Point(x, y + 1)) && grid.passable(Point(x + dx, y + 1)))
+				|| (!grid.passable(Point(x, y - 1)) && grid.passable(Point(x + dx, y - 1)));
+		} else {
+			jumpPoint = jumpPoint
+				|| (!grid.passable(Point(x + 1, y)) && grid.passable(Point(x + 1, y + dy)))
+				|| (!grid.passable(Point(x - 1, y)) && grid.passable(Point(x - 1, y + dy)));
+		}
+		if (jumpPoint) {
+			found = current;
+			return true;
+		}
+	}
+}
+
+/// @brief Jump Point Search: A* that skips over open ground, expanding only jump points
+///
+/// Only valid where every step costs its length (UniformCost); diagonal steps may cut corners, as in gridSearch
+///
+/// Only ascentbench runs it: it expands fewer nodes than gridSearch but takes longer within an FOV window, so the engine doesn't use it
+///
+/// @tparam Grid Grid access policy (e.g. ViewGrid)
+/// @tparam Path Container taking steps through push_back (e.g. PathBuffer, std::vector<Direction>)
+/// @param grid The grid
+/// @param start The starting point
+/// @param finish The ending point
+/// @param workspace Search storage to use
+/// @param path Set to the path, last step first; cleared if none is found
+/// @param expanded Incremented by the number of jump points expanded
+///
+/// @return Whether a path was found
+template <typename Grid, typename Path>
+bool jumpPointSearch(const Grid & grid, const Point& start, const Point& finish, PathWorkspace & workspace, Path & path, unsigned long & expanded) {
+	path.clear();
+	if (!grid.passable(start) || !grid.contains(finish))
+		return false;
+
+	workspace.reset();
+	int startCell = grid.index(start);
+	int finishCell = grid.index(finish);
+	workspace.relax(startCell, 0.0, octileDistance(start, finish), -1, Direction::Up);
+
+	bool success = false;
+	while (!workspace.empty()) {
+		int currentCell = workspace.pop();
+		if (currentCell == finishCell) {
+			success = true;
+			break;
+		}
+		expanded++;
+		Point current = grid.point(currentCell);
+		double current_cost = workspace.costTo(currentCell);
+		int x = current.first;
+		int y = current.second;
+		// Prune to the directions an optimal path could continue in, given the direction it arrived from
+		int dx = 0;
+		int dy = 0;
+		if (currentCell != startCell) {
+			Point parent = grid.point(workspace.parentOf(currentCell));
+			dx = (x > parent.first) - (x < parent.first);
+			dy = (y > parent.second) - (y < parent.second);
+		}
+		for (const auto & disp : displacementMap) {
+			int sx = disp.second.first;
+			int sy = disp.second.second;
+			if (disp.first == Direction::NONE)
+				continue;
+			bool natural;
+			if (dx == 0 && dy == 0)
+				natural = true;
+			else if (dx != 0 && dy != 0)
+				natural = (sx == dx && sy == dy) || (sx == dx && sy == 0) || (sx == 0 && sy == dy)
+					|| (sx == -dx && sy == dy && !grid.passable(Point(x - dx, y)))
+					|| (sx == dx && sy == -dy && !grid.passable(Point(x, y - dy)));
+			else if (dx != 0)
+				natural = (sx == dx && sy == 0)
+					|| (sx == dx && sy != 0 && !grid.passable(Point(x, y + sy)));
+			else
+				natural = (sx == 0 && sy == dy)
+					|| (sy == dy && sx != 0 && !grid.passable(Point(x + sx, y)));
+			if (!natural)
+				continue;
+			Point next;
+			if (!jump(grid, current, disp.second, finish, next))
+				continue;
+			double new_cost = octileDistance(current, next) + current_cost;
+			int nextCell = grid.index(next);
+			if (!workspace.reached(nextCell) || workspace.costTo(nextCell) > new_cost)
+				workspace.relax(nextCell, new_cost, new_cost + octileDistance(next, finish), currentCell, disp.first);
+		}
+	}
+	if (!success)
+		return false;
+
+	// Walk back from the finish, filling in the straight runs between jump points
+	for (int c = finishCell; c != startCell; c = workspace.parentOf(c)) {
+		Point here = grid.point(c);
+		Point there = grid.point(workspace.parentOf(c));
+		int run = MAX(ABS(here.first - there.first), ABS(here.second - there.second));
+		for (int i = 0; i < run; i++)
+			path.push_back(workspace.stepInto(c));
+	}
+	return true;
+}
+
+#endif
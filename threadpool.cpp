@@ -0,0 +1,59 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned int workers) : nextIndex(0) {
+	for (unsigned int w = 1; w < workers; w++)
+		threads.push_back(std::thread(&ThreadPool::workerLoop, this, w));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeCV.notify_all();
+	for (std::thread & thread : threads)
+		thread.join();
+}
+
+void ThreadPool::drain(unsigned int worker) {
+	std::size_t index;
+	while ((index = nextIndex++) < jobCount)
+		(*job)(index, worker);
+}
+
+void ThreadPool::workerLoop(unsigned int worker) {
+	unsigned long seen = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wakeCV.wait(lock, [this, &seen] { return stopping || jobGeneration != seen; });
+		if (stopping)
+			return;
+		seen = jobGeneration;
+		lock.unlock();
+		drain(worker);
+		lock.lock();
+		if (--busy == 0)
+			doneCV.notify_one();
+	}
+}
+
+void ThreadPool::run(std::size_t count, const std::function<void(std::size_t, unsigned int)> & f) {
+	if (threads.empty()) {
+		for (std::size_t i = 0; i < count; i++)
+			f(i, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &f;
+		jobCount = count;
+		nextIndex = 0;
+		busy = (unsigned int)threads.size();
+		jobGeneration++;
+	}
+	wakeCV.notify_all();
+	drain(0);
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCV.wait(lock, [this] { return busy == 0; });
+	job = NULL;
+}
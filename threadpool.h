@@ -0,0 +1,83 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+/// @brief Fixed set of worker threads for running parallel loops
+///
+/// The calling thread takes part as worker 0, so a pool of one runs everything inline
+class ThreadPool {
+	private:
+		/// @brief The extra threads (workers 1 and up)
+		std::vector<std::thread> threads;
+
+		/// @brief Guards the job fields below
+		std::mutex mutex;
+
+		/// @brief Signalled when a new job starts, or the pool is stopping
+		std::condition_variable wakeCV;
+
+		/// @brief Signalled when the last thread finishes a job
+		std::condition_variable doneCV;
+
+		/// @brief The current job
+		const std::function<void(std::size_t, unsigned int)> * job = NULL;
+
+		/// @brief The number of indices in the current job
+		std::size_t jobCount = 0;
+
+		/// @brief The next index to hand out
+		std::atomic<std::size_t> nextIndex;
+
+		/// @brief The number of extra threads still working on the current job
+		unsigned int busy = 0;
+
+		/// @brief Bumped for every job, so threads can tell a new one from the last
+		unsigned long jobGeneration = 0;
+
+		/// @brief Set when the pool is being destroyed
+		bool stopping = false;
+
+		/// @brief Main loop of an extra thread
+		///
+		/// @param worker The worker number
+		void workerLoop(unsigned int worker);
+
+		/// @brief Take and run indices of the current job until there are none left
+		///
+		/// @param worker The worker number
+		void drain(unsigned int worker);
+
+	public:
+		/// @brief Constructor
+		///
+		/// @param workers The number of workers, including the calling thread (at least 1)
+		ThreadPool(unsigned int workers);
+
+		/// @brief Destructor; stops and joins the threads
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/// @brief Expose the number of workers
+		///
+		/// @return The count, including the calling thread
+		inline unsigned int size() const {
+			return (unsigned int)threads.size() + 1;
+		}
+
+		/// @brief Call a function for every index from 0 to count - 1, spread over the workers, and wait for them all
+		///
+		/// @param count The number of indices
+		/// @param f The function, taking the index and the number of the worker running it
+		void run(std::size_t count, const std::function<void(std::size_t, unsigned int)> & f);
+};
+
+#endif
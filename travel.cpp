@@ -0,0 +1,143 @@
+#include "engine.h"
+#include <map>
+#include <set>
+#include <functional>
+#include <algorithm>
+#include <limits>
+
+bool Engine::beginTravel(Point finish) {
+	cancelTravel();
+	// Each entry holds a region, the destination translated into its frame and the entry it was reached from
+	struct Reached {
+		Region * region;
+		Point goal;
+		int from;
+	};
+	std::vector<Reached> reached;
+	std::set<Region *> seen;
+	reached.push_back({player->getRegion(), PAIR_SUM(player->getPosition(), finish), -1});
+	std::size_t depthStart = 0;
+	for (int depth = 0; depth <= TRAVEL_SEARCH_DEPTH && depthStart < reached.size(); depth++) {
+		std::size_t depthEnd = reached.size();
+		for (std::size_t i = depthStart; i < depthEnd; i++) {
+			Region * region = reached[i].region;
+			Point goal = reached[i].goal;
+			if (!seen.insert(region).second)
+				continue;
+			if (goal.first >= 0 && goal.first < region->Width() && goal.second >= 0 && goal.second < region->Height()
+					&& bkgrProps.at(region->getBackground(goal)).passible) {
+				travelRegion = region;
+				travelGoal = goal;
+				for (int at = (int)i; at != -1; at = reached[at].from)
+					travelRoute.push_back(reached[at].region);
+				return true;
+			}
+			// Only look through doors that face the destination
+			for (const Point & door : region->Doors()) {
+				Connection cn = region->connectionAt(door);
+				Point muldir = PAIR_MULTIPLY(DISPLACEMENT(cn.direction), PAIR_SUBTRACT(goal, door));
+				if (muldir.first <= 0 && muldir.second <= 0)
+					continue;
+				// A neighbour dropped from memory is brought back, as walking through the door would
+				if (cn.to == NULL && restoreLink(region, door) != NULL)
+					cn = region->connectionAt(door);
+				if (cn.to != NULL)
+					reached.push_back({cn.to, PAIR_SUM(PAIR_SUBTRACT(goal, door), cn.toLocation), (int)i});
+			}
+		}
+		depthStart = depthEnd;
+	}
+	return false;
+}
+
+Direction Engine::travelStep() {
+	if (travelRegion == NULL)
+		return Direction::NONE;
+	Region * here = player->getRegion();
+	Point position = player->getPosition();
+	if (here == travelRegion && position == travelGoal) {
+		cancelTravel();
+		return Direction::NONE;
+	}
+
+	// Nodes are doors (region, index into Doors()), plus the player and the goal
+	using Node = std::pair<Region *, int>;
+	const Node start(NULL, -1);
+	const Node goal(NULL, -2);
+	travelStartField.buildFrom(here, position, pathspace);
+	travelGoalField.buildFrom(travelRegion, travelGoal, pathspace);
+
+	// Region frames don't line up with each other, so there is no heuristic to guide this; it is plain Dijkstra
+	std::map<Node, double> cost;
+	std::map<Node, Node> parent;
+	std::priority_queue<std::pair<double, Node>, std::vector<std::pair<double, Node>>, std::greater<std::pair<double, Node>>> frontier;
+	auto relax = [&](const Node & node, double c, const Node & from) {
+		if (c == std::numeric_limits<double>::infinity())
+			return;
+		auto it = cost.find(node);
+		if (it != cost.end() && it->second <= c)
+			return;
+		cost[node] = c;
+		parent[node] = from;
+		frontier.push({c, node});
+	};
+	relax(start, 0, start);
+	while (!frontier.empty()) {
+		double c = frontier.top().first;
+		Node node = frontier.top().second;
+		frontier.pop();
+		if (c > cost[node])
+			continue;
+		if (node == goal)
+			break;
+		if (node == start) {
+			for (std::size_t i = 0; i < here->Doors().size(); i++)
+				relax(Node(here, (int)i), travelStartField.distanceAt(here->Doors()[i]), start);
+			if (here == travelRegion)
+				relax(goal, travelGoalField.distanceAt(position), start);
+			continue;
+		}
+		Region * region = node.first;
+		const Point & door = region->Doors()[node.second];
+		for (std::size_t j = 0; j < region->Doors().size(); j++)
+			if ((int)j != node.second)
+				relax(Node(region, (int)j), c + region->doorCost(node.second, (int)j), node);
+		// Both sides of a connection are the same tile
+		Connection cn = region->connectionAt(door);
+		if (cn.to != NULL) {
+			int across = cn.to->doorIndex(cn.toLocation);
+			if (across != -1)
+				relax(Node(cn.to, across), c, node);
+		}
+		if (region == travelRegion)
+			relax(goal, c + travelGoalField.distanceAt(door), node);
+	}
+	if (cost.find(goal) == cost.end()) {
+		cancelTravel();
+		return Direction::NONE;
+	}
+
+	std::vector<Node> route;
+	for (Node node = goal; node != start; node = parent[node])
+		route.push_back(node);
+	std::reverse(route.begin(), route.end());
+
+	// Only the first leg that actually moves within a region is refined into steps
+	Region * legRegion = here;
+	Point legStart = position;
+	for (const Node & node : route) {
+		Region * region = (node == goal) ? travelRegion : node.first;
+		Point legEnd = (node == goal) ? travelGoal : region->Doors()[node.second];
+		if (region == legRegion && legEnd != legStart) {
+			travelField.buildFrom(region, legEnd, pathspace);
+			Direction step = travelField.downhill(legStart);
+			if (step == Direction::NONE)
+				cancelTravel();
+			return step;
+		}
+		legRegion = region;
+		legStart = legEnd;
+	}
+	cancelTravel();
+	return Direction::NONE;
+}
@@ -0,0 +1,92 @@
+#include "worldfile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+WorldFile::~WorldFile() {
+	if (base != NULL)
+		munmap(base, capacity);
+	if (fd != -1)
+		close(fd);
+}
+
+bool WorldFile::reserve(std::size_t needed) {
+	if (needed <= capacity)
+		return true;
+	if (fd == -1) {
+		const char * dir = getenv("TMPDIR");
+		std::string path = std::string((dir != NULL && dir[0] != '\0') ? dir : "/tmp") + "/ascentworldXXXXXX";
+		fd = mkstemp(&path[0]);
+		if (fd == -1) {
+			fprintf(stderr, "Could not create a world file in %s\n", path.c_str());
+			return false;
+		}
+		unlink(path.c_str());
+	}
+	std::size_t grown = MAX(needed, capacity + WORLDFILE_GROWTH);
+	if (ftruncate(fd, (off_t)grown) != 0) {
+		fprintf(stderr, "Could not grow the world file to %lu bytes\n", (unsigned long)grown);
+		return false;
+	}
+	void * mapped = mmap(NULL, grown, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED) {
+		fprintf(stderr, "Could not map the world file\n");
+		return false;
+	}
+	if (base != NULL)
+		munmap(base, capacity);
+	base = static_cast<uint8_t *>(mapped);
+	capacity = grown;
+	return true;
+}
+
+WorldExtent WorldFile::write(const RecordWriter & record) {
+	WorldExtent extent;
+	std::size_t length = record.data().size();
+	if (length == 0)
+		return extent;
+	bool reused = false;
+	for (auto it = freeExtents.begin(); it != freeExtents.end(); ++it)
+		if (it->length >= length) {
+			extent.offset = it->offset;
+			it->offset += length;
+			it->length -= length;
+			if (it->length == 0)
+				freeExtents.erase(it);
+			reused = true;
+			break;
+		}
+	if (!reused) {
+		if (!reserve(used + length))
+			return extent;
+		extent.offset = used;
+		used += length;
+	}
+	std::memcpy(base + extent.offset, record.data().data(), length);
+	extent.length = length;
+	return extent;
+}
+
+void WorldFile::release(const WorldExtent & extent) {
+	if (extent.length == 0)
+		return;
+	// Kept sorted by offset, with neighbours merged, so that space freed piecemeal can hold a bigger record
+	auto it = freeExtents.begin();
+	while (it != freeExtents.end() && it->offset < extent.offset)
+		++it;
+	it = freeExtents.insert(it, extent);
+	auto next = it + 1;
+	if (next != freeExtents.end() && it->offset + it->length == next->offset) {
+		it->length += next->length;
+		freeExtents.erase(next);
+	}
+	if (it != freeExtents.begin()) {
+		auto prev = it - 1;
+		if (prev->offset + prev->length == it->offset) {
+			prev->length += it->length;
+			freeExtents.erase(it);
+		}
+	}
+}
@@ -0,0 +1,190 @@
+#ifndef WORLDFILE_H
+#define WORLDFILE_H
+
+#include "general.h"
+#include <vector>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+/// @brief The world file grows by at least this many bytes at a time
+#define WORLDFILE_GROWTH (1 << 20)
+
+/// @brief Builds a binary record, field by field
+class RecordWriter {
+	private:
+		/// @brief The record so far
+		std::vector<uint8_t> bytes;
+
+	public:
+		/// @brief Append a field
+		///
+		/// @tparam T A trivially copyable type
+		/// @param value The value
+		template <typename T>
+		inline void put(const T & value) {
+			put(&value, 1);
+		}
+
+		/// @brief Append a point
+		///
+		/// @param value The point
+		inline void put(const Point & value) {
+			put(value.first);
+			put(value.second);
+		}
+
+		/// @brief Append an array of fields
+		///
+		/// @tparam T A trivially copyable type
+		/// @param values The values
+		/// @param count How many there are
+		template <typename T>
+		inline void put(const T * values, std::size_t count) {
+			static_assert(std::is_trivially_copyable<T>::value, "Records hold only trivially copyable fields");
+			// An empty array may come with a null pointer, which memcpy and insert mustn't be handed
+			if (count == 0)
+				return;
+			const uint8_t * raw = reinterpret_cast<const uint8_t *>(values);
+			bytes.insert(bytes.end(), raw, raw + count * sizeof(T));
+		}
+
+		/// @brief Expose the record
+		///
+		/// @return The bytes
+		inline const std::vector<uint8_t>& data() const {
+			return bytes;
+		}
+};
+
+/// @brief Reads back a binary record field by field, in the order it was written
+class RecordReader {
+	private:
+		/// @brief The next unread byte
+		const uint8_t * at;
+
+		/// @brief One past the last byte
+		const uint8_t * end;
+
+	public:
+		/// @brief Constructor
+		///
+		/// @param data The record (not owned)
+		/// @param length Its length in bytes
+		RecordReader(const uint8_t * data, std::size_t length) : at(data), end(data + length) {}
+
+		/// @brief Read a field
+		///
+		/// @tparam T A trivially copyable type
+		/// @param value Set to the value
+		template <typename T>
+		inline void get(T & value) {
+			get(&value, 1);
+		}
+
+		/// @brief Read a point
+		///
+		/// @param value Set to the point
+		inline void get(Point & value) {
+			get(value.first);
+			get(value.second);
+		}
+
+		/// @brief Read an array of fields; fields past the end of the record are zeroed
+		///
+		/// @tparam T A trivially copyable type
+		/// @param values Set to the values
+		/// @param count How many to read
+		template <typename T>
+		inline void get(T * values, std::size_t count) {
+			static_assert(std::is_trivially_copyable<T>::value, "Records hold only trivially copyable fields");
+			if (count == 0)
+				return;
+			std::size_t length = count * sizeof(T);
+			if ((std::size_t)(end - at) < length) {
+				fprintf(stderr, "Read past the end of a world file record\n");
+				std::memset(static_cast<void *>(values), 0, length);
+				at = end;
+				return;
+			}
+			std::memcpy(static_cast<void *>(values), at, length);
+			at += length;
+		}
+};
+
+/// @brief Where a record lies in the world file
+struct WorldExtent {
+	/// @brief Offset from the start of the file
+	std::size_t offset = 0;
+	/// @brief Length in bytes; 0 if there is no record
+	std::size_t length = 0;
+};
+
+/// @brief A memory-mapped scratch file holding records of regions paged out of memory
+///
+/// The file is created on the first write and unlinked straight away, so it goes when the game does
+class WorldFile {
+	private:
+		/// @brief The file descriptor, or -1 if not yet created
+		int fd = -1;
+
+		/// @brief The mapping of the whole file
+		uint8_t * base = NULL;
+
+		/// @brief The size of the file (and mapping)
+		std::size_t capacity = 0;
+
+		/// @brief One past the last byte ever written
+		std::size_t used = 0;
+
+		/// @brief Space released by records that have been read back, reused first fit
+		std::vector<WorldExtent> freeExtents;
+
+		/// @brief Create the file if needed, and grow it and its mapping to hold at least a number of bytes
+		///
+		/// @param needed The number of bytes
+		///
+		/// @return Success/fail
+		bool reserve(std::size_t needed);
+
+	public:
+		/// @brief Constructor
+		WorldFile() {}
+
+		/// @brief Destructor; unmaps and closes the file
+		~WorldFile();
+
+		WorldFile(const WorldFile&) = delete;
+		WorldFile& operator=(const WorldFile&) = delete;
+
+		/// @brief Write a record
+		///
+		/// @param record The record
+		///
+		/// @return Where it was written; the length is 0 if it couldn't be
+		WorldExtent write(const RecordWriter & record);
+
+		/// @brief Expose a record; valid until the next write
+		///
+		/// @param extent Where the record is
+		///
+		/// @return The record's bytes
+		inline const uint8_t * read(const WorldExtent & extent) const {
+			return base + extent.offset;
+		}
+
+		/// @brief Release a record's space for reuse
+		///
+		/// @param extent Where the record is
+		void release(const WorldExtent & extent);
+
+		/// @brief Expose the size of the file
+		///
+		/// @return The size in bytes
+		inline std::size_t size() const {
+			return capacity;
+		}
+};
+
+#endif